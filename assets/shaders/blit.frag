@@ -3,6 +3,9 @@
 layout(push_constant) uniform HDRSettings {
     float Exposure;
     float Gamma;
+    int EdgeAwareUpsampling;
+    float RenderScaleX;
+    float RenderScaleY;
 };
 
 layout(location = 0) out vec4 out_color;
@@ -15,10 +18,52 @@ layout(location = 0) in struct {
     vec2 texcoord;
 } v_in;
 
+float fetchDepth(ivec2 coord, ivec2 size) {
+    float depth = texelFetch(sampler2D(depthTexture, textureSampler), clamp(coord, ivec2(0), size - 1), 0).w;
+    return depth > 0.0f ? depth : 1e6f;
+}
+
+// Bilinear upsampling where each tap is additionally weighted by how close its
+// depth is to the nearest source texel, so silhouettes do not bleed.
+vec3 upsampleEdgeAware(vec2 texcoord, vec2 renderScale) {
+    ivec2 size = ivec2(vec2(textureSize(sampler2D(albedoTexture, textureSampler), 0)) * renderScale + 0.5f);
+
+    vec2 st = texcoord * vec2(size) - 0.5f;
+    ivec2 base = ivec2(floor(st));
+    vec2 f = fract(st);
+
+    float nearestDepth = fetchDepth(ivec2(round(st)), size);
+
+    vec3 sum = vec3(0.0f);
+    float weightSum = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 coord = clamp(base + offset, ivec2(0), size - 1);
+
+        vec2 bilinear = mix(1.0f - f, f, vec2(offset));
+        float depth = fetchDepth(coord, size);
+        float weight = bilinear.x * bilinear.y / (1e-3f + abs(depth - nearestDepth) / nearestDepth);
+
+        sum += texelFetch(sampler2D(albedoTexture, textureSampler), coord, 0).rgb * weight;
+        weightSum += weight;
+    }
+    return sum / max(weightSum, 1e-5f);
+}
+
 void main() {
-    vec3 color = texture(sampler2D(albedoTexture, textureSampler), v_in.texcoord).rgb;
+    vec2 renderScale = vec2(RenderScaleX, RenderScaleY);
+
+    // Only the render-size sub-rect of the targets holds the current frame.
+    vec3 color;
+    if (EdgeAwareUpsampling != 0) {
+        color = upsampleEdgeAware(v_in.texcoord, renderScale);
+    } else {
+        vec2 sourceSize = vec2(textureSize(sampler2D(albedoTexture, textureSampler), 0));
+        vec2 texcoord = min(v_in.texcoord * renderScale, renderScale - 0.5f / sourceSize);
+        color = texture(sampler2D(albedoTexture, textureSampler), texcoord).rgb;
+    }
 
     color = 1.0f - exp(-color * Exposure);
     color = pow(color, vec3(1.0f / Gamma));
     out_color = vec4(color, 1.0f);
-}
\ No newline at end of file
+}
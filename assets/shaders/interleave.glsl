@@ -0,0 +1,30 @@
+#ifndef VFX_INTERLEAVE
+#define VFX_INTERLEAVE
+
+// Interleaved tracing: with interleave == 2 pixels form a checkerboard and
+// each half is traced on alternating frames, with interleave == 4 one pixel
+// of every 2x2 quad is traced per frame.
+
+ivec2 getInterleavedCoord(ivec2 id, int interleave, int frameIndex) {
+    if (interleave == 2) {
+        return ivec2(id.x * 2 + ((id.y + frameIndex) & 1), id.y);
+    }
+    if (interleave == 4) {
+        int phase = frameIndex & 3;
+        return id * 2 + ivec2(phase & 1, phase >> 1);
+    }
+    return id;
+}
+
+bool isInterleavedCoordTraced(ivec2 coord, int interleave, int frameIndex) {
+    if (interleave == 2) {
+        return ((coord.x + coord.y + frameIndex) & 1) == 0;
+    }
+    if (interleave == 4) {
+        int phase = frameIndex & 3;
+        return (coord & 1) == ivec2(phase & 1, phase >> 1);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,906 @@
+#ifndef VFX_RAYTRACE
+#define VFX_RAYTRACE
+
+struct RaytraceTriangle {
+    vec4 v0;
+    vec4 edge1;
+    vec4 edge2;
+};
+
+struct Light {
+    vec3  position;
+    float pad0;
+    vec3  color;
+    float brightness;
+    float intensity;
+    float radius;
+};
+
+struct LightTreeNode {
+    vec3  boundsMin;
+    float power;
+    vec3  boundsMax;
+    int   rightChild;
+    int   lightIndex;
+};
+
+layout(set = 0, binding = 0, rgba32f) uniform image2D averrageTexture;
+layout(set = 0, binding = 1, rgba32f) uniform image2D accumulateTexture;
+layout(set = 0, binding = 2) readonly buffer ray_directions_data {
+    vec4 rayDirections[];
+};
+layout(set = 0, binding = 3) readonly buffer index_buffer_object {
+    int indices[];
+};
+// Intersection only reads the triangle buffer, the indices and vertex
+// attributes are fetched for the closest hit alone, see RaytraceScene.
+layout(set = 0, binding = 4) readonly buffer triangle_data {
+    RaytraceTriangle triangles[];
+};
+layout(set = 0, binding = 19) readonly buffer vertex_attribute_data {
+    uvec2 vertexAttributes[];
+};
+layout(set = 0, binding = 5) uniform sampler mainSampler;
+// Stages that include this file enable GL_EXT_nonuniform_qualifier, the
+// texture index differs between lanes.
+const int kMaxTextures = 256;
+
+layout(set = 0, binding = 6) uniform texture2D textures[kMaxTextures];
+layout(set = 0, binding = 7, rgba32f) uniform writeonly image2D normalDepthTexture;
+layout(set = 0, binding = 8, rgba8) uniform writeonly image2D albedoTexture;
+layout(set = 0, binding = 13) readonly buffer light_data {
+    Light lights[];
+};
+layout(set = 0, binding = 14) readonly buffer light_tree_data {
+    LightTreeNode lightNodes[];
+};
+layout(set = 0, binding = 15) readonly buffer light_leaf_data {
+    int lightLeaves[];
+};
+
+// Material properties are separate streams of one table, see MaterialTable.
+layout(set = 0, binding = 16) readonly buffer material_albedo_data {
+    vec4 materialAlbedos[];
+};
+// First texture array slot and mip level count, see TextureArray.
+layout(set = 0, binding = 17) readonly buffer material_texture_data {
+    ivec2 materialTextures[];
+};
+// 16-bit material index per triangle, two to a word.
+layout(set = 0, binding = 18) readonly buffer triangle_material_data {
+    uint triangleMaterials[];
+};
+// Dense box of blocks in world space, one byte per block, see VoxelGrid.
+layout(set = 0, binding = 20) readonly buffer voxel_grid_data {
+    ivec4 voxelGridOrigin;
+    ivec4 voxelGridSize;
+    uint voxelBlocks[];
+};
+// Coarse grid over 8x8x8 bricks in world space and the brick pool it points
+// into, see Brickmap. Cells are stored wrapped around the grid size with the
+// origin cell at brickmapOffset.
+layout(set = 0, binding = 21) readonly buffer brickmap_data {
+    ivec4 brickmapOrigin;
+    ivec4 brickmapSize;
+    ivec4 brickmapOffset;
+    uint brickCells[];
+};
+layout(set = 0, binding = 22) readonly buffer brick_data {
+    uint brickBlocks[];
+};
+// 2x, 4x and 8x coarser copies of every cell.
+layout(set = 0, binding = 23) readonly buffer brick_lod_data {
+    uint brickLods[];
+};
+
+layout(push_constant) uniform push_constant_data {
+    vec3 cameraPosition;
+    float time;
+    int accumulateFrame;
+    int renderWidth;
+    int renderHeight;
+    int interleave;
+    int frameIndex;
+    int tileWidth;
+    int tileHeight;
+    int mortonOrder;
+    int maxBounces;
+    int rouletteDepth;
+    int nextEventEstimation;
+    int lightTree;
+    int voxelWorld;
+    float voxelLodDistance;
+    int materialCount;
+    // The light buffers always hold at least one element, only this many
+    // are lights.
+    int lightCount;
+};
+
+const float kEpsilon = 1e-5f;
+
+const vec3 kSkyColor = vec3(.6f, .7f, .9f);
+const vec3 kLightDirection = normalize(vec3(-1, -1, 1));
+const float kLightIntensity = 1.0f;
+
+struct AabbPositions {
+    float minX;
+    float minY;
+    float minZ;
+    float maxX;
+    float maxY;
+    float maxZ;
+};
+
+struct HitResult {
+    float Distance;
+    vec3  Normal;
+    vec3  Position;
+    vec2  TexCoord;
+    uint  Material;
+    // Half the log2 of texcoord area per world area of the hit triangle.
+    float TexelDensity;
+};
+
+const float kPI = 3.14159265358979323846f;
+
+uint rngState;
+
+uint pcgHash(uint value) {
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+void initRandom(in ivec2 coord, in int frame) {
+    rngState = pcgHash(uint(coord.x) + pcgHash(uint(coord.y) + pcgHash(uint(frame))));
+}
+
+float nextRandom() {
+    rngState = pcgHash(rngState);
+    return float(rngState) * (1.0f / 4294967296.0f);
+}
+
+vec3 sampleCosineHemisphere(in vec3 normal) {
+    float phi = 2.0f * kPI * nextRandom();
+    float r2 = nextRandom();
+    float r = sqrt(r2);
+
+    vec3 tangent = normalize(cross(normal, abs(normal.x) > 0.9f ? vec3(0, 1, 0) : vec3(1, 0, 0)));
+    vec3 bitangent = cross(normal, tangent);
+
+    return normalize(tangent * (cos(phi) * r) + bitangent * (sin(phi) * r) + normal * sqrt(1.0f - r2));
+}
+
+// Moller-Trumbore against a precomputed vertex and edges. The determinant
+// is -dot(N, rayDirection), so both faces are hit. The barycentrics are the
+// weights of v1 and v2.
+bool intersectTriangle(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in RaytraceTriangle triangle,
+    inout float distance,
+    out vec2 barycentrics
+) {
+    vec3 edge1 = triangle.edge1.xyz;
+    vec3 edge2 = triangle.edge2.xyz;
+
+    vec3 pvec = cross(rayDirection, edge2);
+    float det = dot(edge1, pvec);
+    if (abs(det) < kEpsilon) {
+        return false;
+    }
+    float inverseDet = 1.0f / det;
+
+    vec3 tvec = rayOrigin - triangle.v0.xyz;
+    float u = dot(tvec, pvec) * inverseDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    vec3 qvec = cross(tvec, edge1);
+    float v = dot(rayDirection, qvec) * inverseDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+
+    float d = dot(edge2, qvec) * inverseDet;
+    if (d < 0.0f || distance < d) {
+        return false;
+    }
+
+    distance = d;
+    barycentrics = vec2(u, v);
+    return true;
+}
+
+HitResult missHit() {
+    HitResult ret;
+    ret.Distance = -1;
+    return ret;
+}
+
+HitResult createHit(float distance, in vec3 normal, in vec3 position, in vec2 texcoord, uint material, float texelDensity) {
+    HitResult ret;
+    ret.Distance = distance;
+    ret.Normal = normal;
+    ret.Position = position;
+    ret.TexCoord = texcoord;
+    ret.Material = material;
+    ret.TexelDensity = texelDensity;
+    return ret;
+}
+
+vec3 decodeOctahedral(in vec2 e) {
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+
+vec3 getVertexNormal(int index) {
+    return decodeOctahedral(unpackSnorm2x16(vertexAttributes[index].x));
+}
+
+vec2 getVertexTexCoord(int index) {
+    return unpackHalf2x16(vertexAttributes[index].y);
+}
+
+uint getTriangleMaterial(int triangle) {
+    return (triangleMaterials[triangle >> 1] >> ((triangle & 1) * 16)) & 0xffffu;
+}
+
+HitResult traceTriangles(
+    in vec3 rayOrigin,
+    in vec3 rayDirection
+) {
+    int closest = -1;
+
+    vec2 barycentrics;
+    float distance = 100000.0f;
+    for (int i = 0; i < triangles.length(); ++i) {
+        vec2 b;
+        if (intersectTriangle(rayOrigin, rayDirection, triangles[i], distance, b)) {
+            closest = i;
+            barycentrics = b;
+        }
+    }
+
+    if (closest >= 0) {
+        int firstIndex = closest * 3;
+        vec3 weights = vec3(1.0f - barycentrics.x - barycentrics.y, barycentrics);
+
+        vec3 n1 = getVertexNormal(indices[firstIndex + 0]);
+        vec3 n2 = getVertexNormal(indices[firstIndex + 1]);
+        vec3 n3 = getVertexNormal(indices[firstIndex + 2]);
+
+        vec2 uv1 = getVertexTexCoord(indices[firstIndex + 0]);
+        vec2 uv2 = getVertexTexCoord(indices[firstIndex + 1]);
+        vec2 uv3 = getVertexTexCoord(indices[firstIndex + 2]);
+
+        vec3 position = rayOrigin + rayDirection * distance;
+        vec3 normal = weights.x * n1 + weights.y * n2 + weights.z * n3;
+        vec2 texcoord = weights.x * uv1 + weights.y * uv2 + weights.z * uv3;
+
+        vec2 uvEdge1 = uv2 - uv1;
+        vec2 uvEdge2 = uv3 - uv1;
+        float uvArea = abs(uvEdge1.x * uvEdge2.y - uvEdge1.y * uvEdge2.x);
+        float worldArea = length(cross(triangles[closest].edge1.xyz, triangles[closest].edge2.xyz));
+        float texelDensity = 0.5f * log2(uvArea / worldArea);
+
+        return createHit(distance, normal, position, texcoord, getTriangleMaterial(closest), texelDensity);
+    }
+
+    return missHit();
+}
+
+// Shadow rays only need to know whether anything is in the way, so the loop
+// stops at the first triangle closer than the light.
+bool isTriangleOccluded(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance
+) {
+    for (int i = 0; i < triangles.length(); ++i) {
+        vec2 barycentrics;
+        float distance = maxDistance;
+        if (intersectTriangle(rayOrigin, rayDirection, triangles[i], distance, barycentrics)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint getVoxel(in ivec3 cell) {
+    uint index = uint((cell.y * voxelGridSize.z + cell.z) * voxelGridSize.x + cell.x);
+    return (voxelBlocks[index >> 2] >> ((index & 3u) * 8u)) & 0xffu;
+}
+
+// Amanatides-Woo traversal of the voxel grid, one step per cell boundary the
+// ray crosses. Returns the first solid block closer than maxDistance and the
+// normal of the face the ray entered it through.
+bool traverseVoxels(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance,
+    out float distance,
+    out vec3 normal,
+    out uint block
+) {
+    vec3 inverseDirection = 1.0f / rayDirection;
+    vec3 t0 = (vec3(voxelGridOrigin.xyz) - rayOrigin) * inverseDirection;
+    vec3 t1 = (vec3(voxelGridOrigin.xyz + voxelGridSize.xyz) - rayOrigin) * inverseDirection;
+    vec3 tEnter = min(t0, t1);
+    float tNear = max(max(tEnter.x, tEnter.y), max(tEnter.z, 0.0f));
+    float tFar = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), min(max(t0.z, t1.z), maxDistance));
+    if (tNear >= tFar) {
+        return false;
+    }
+
+    ivec3 step = ivec3(sign(rayDirection));
+    ivec3 cell = clamp(ivec3(floor(rayOrigin + rayDirection * tNear)) - voxelGridOrigin.xyz, ivec3(0), voxelGridSize.xyz - 1);
+
+    // Distance to the next boundary on each axis, axes the ray is parallel
+    // to never reach one.
+    vec3 tDelta = abs(inverseDirection);
+    vec3 boundary = vec3(voxelGridOrigin.xyz + cell + max(step, ivec3(0)));
+    vec3 tNext = mix(vec3(1e30f), (boundary - rayOrigin) * inverseDirection, notEqual(step, ivec3(0)));
+
+    normal = -vec3(step) * vec3(equal(tEnter, vec3(tNear)));
+    distance = tNear;
+
+    int maxSteps = voxelGridSize.x + voxelGridSize.y + voxelGridSize.z;
+    for (int i = 0; i < maxSteps; ++i) {
+        block = getVoxel(cell);
+        if (block != 0u) {
+            return true;
+        }
+
+        if (tNext.x < tNext.y && tNext.x < tNext.z) {
+            cell.x += step.x;
+            distance = tNext.x;
+            tNext.x += tDelta.x;
+            normal = vec3(-step.x, 0, 0);
+        } else if (tNext.y < tNext.z) {
+            cell.y += step.y;
+            distance = tNext.y;
+            tNext.y += tDelta.y;
+            normal = vec3(0, -step.y, 0);
+        } else {
+            cell.z += step.z;
+            distance = tNext.z;
+            tNext.z += tDelta.z;
+            normal = vec3(0, 0, -step.z);
+        }
+
+        if (distance > tFar || any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, voxelGridSize.xyz))) {
+            return false;
+        }
+    }
+    return false;
+}
+
+const uint kEmptyBrick = 0xffffffffu;
+// Solid cell without full resolution data, only its coarse levels exist.
+const uint kCoarseBrick = 0xfffffffeu;
+const int kBrickSize = 8;
+
+const int kBrickLodLevels = 3;
+const uint kBrickLodBytes = 80u;
+const uint kBrickLodOffsets[4] = uint[](0u, 0u, 64u, 72u);
+
+// Level 0 is read from the brick, level n has cells of 2^n blocks and is
+// read from the coarse levels of the grid cell.
+uint getBrickVoxel(in uint brick, in uint gridCell, in int level, in ivec3 cell) {
+    int size = kBrickSize >> level;
+    uint offset = uint((cell.y * size + cell.z) * size + cell.x);
+    if (level == 0) {
+        uint index = brick * uint(kBrickSize * kBrickSize * kBrickSize) + offset;
+        return (brickBlocks[index >> 2] >> ((index & 3u) * 8u)) & 0xffu;
+    }
+    uint index = gridCell * kBrickLodBytes + kBrickLodOffsets[level] + offset;
+    return (brickLods[index >> 2] >> ((index & 3u) * 8u)) & 0xffu;
+}
+
+// Full detail up to voxelLodDistance from the camera, then one level coarser
+// every time the distance doubles. Zero turns the levels off.
+int getBrickLevel(in float distance) {
+    if (voxelLodDistance <= 0.0f || distance < voxelLodDistance) {
+        return 0;
+    }
+    return min(int(log2(distance / voxelLodDistance)) + 1, kBrickLodLevels);
+}
+
+// Same stepping as traverseVoxels inside one brick at the given level, from
+// where the coarse traversal entered it to where it leaves.
+bool traverseBrick(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in vec3 inverseDirection,
+    in uint brick,
+    in uint gridCell,
+    in int level,
+    in ivec3 brickOrigin,
+    in float tExit,
+    inout float distance,
+    inout vec3 normal,
+    out uint block
+) {
+    int size = kBrickSize >> level;
+    ivec3 step = ivec3(sign(rayDirection));
+    ivec3 cell = clamp((ivec3(floor(rayOrigin + rayDirection * distance)) - brickOrigin) >> level, ivec3(0), ivec3(size - 1));
+
+    vec3 tDelta = abs(inverseDirection) * float(1 << level);
+    vec3 boundary = vec3(brickOrigin + ((cell + max(step, ivec3(0))) << level));
+    vec3 tNext = mix(vec3(1e30f), (boundary - rayOrigin) * inverseDirection, notEqual(step, ivec3(0)));
+
+    for (int i = 0; i < size * 3; ++i) {
+        block = getBrickVoxel(brick, gridCell, level, cell);
+        if (block != 0u) {
+            return true;
+        }
+
+        if (tNext.x < tNext.y && tNext.x < tNext.z) {
+            cell.x += step.x;
+            distance = tNext.x;
+            tNext.x += tDelta.x;
+            normal = vec3(-step.x, 0, 0);
+        } else if (tNext.y < tNext.z) {
+            cell.y += step.y;
+            distance = tNext.y;
+            tNext.y += tDelta.y;
+            normal = vec3(0, -step.y, 0);
+        } else {
+            cell.z += step.z;
+            distance = tNext.z;
+            tNext.z += tDelta.z;
+            normal = vec3(0, 0, -step.z);
+        }
+
+        if (distance > tExit || any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, ivec3(size)))) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Steps through the coarse grid a brick at a time and only descends into
+// bricks that hold a solid block, so empty space costs one step per 8 blocks.
+// Distant bricks are stepped through at a coarser level.
+bool traverseBrickmap(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance,
+    out float distance,
+    out vec3 normal,
+    out uint block
+) {
+    vec3 inverseDirection = 1.0f / rayDirection;
+    vec3 boundsMin = vec3(brickmapOrigin.xyz);
+    vec3 boundsMax = vec3(brickmapOrigin.xyz + brickmapSize.xyz * kBrickSize);
+    vec3 t0 = (boundsMin - rayOrigin) * inverseDirection;
+    vec3 t1 = (boundsMax - rayOrigin) * inverseDirection;
+    vec3 tEnter = min(t0, t1);
+    float tNear = max(max(tEnter.x, tEnter.y), max(tEnter.z, 0.0f));
+    float tFar = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), min(max(t0.z, t1.z), maxDistance));
+    if (tNear >= tFar) {
+        return false;
+    }
+
+    ivec3 step = ivec3(sign(rayDirection));
+    ivec3 cell = clamp((ivec3(floor(rayOrigin + rayDirection * tNear)) - brickmapOrigin.xyz) / kBrickSize, ivec3(0), brickmapSize.xyz - 1);
+
+    vec3 tDelta = abs(inverseDirection) * float(kBrickSize);
+    vec3 boundary = vec3(brickmapOrigin.xyz + (cell + max(step, ivec3(0))) * kBrickSize);
+    vec3 tNext = mix(vec3(1e30f), (boundary - rayOrigin) * inverseDirection, notEqual(step, ivec3(0)));
+
+    normal = -vec3(step) * vec3(equal(tEnter, vec3(tNear)));
+    distance = tNear;
+
+    int maxSteps = brickmapSize.x + brickmapSize.y + brickmapSize.z;
+    for (int i = 0; i < maxSteps; ++i) {
+        ivec3 stored = cell + brickmapOffset.xyz;
+        stored -= ivec3(greaterThanEqual(stored, brickmapSize.xyz)) * brickmapSize.xyz;
+        uint gridCell = uint((stored.y * brickmapSize.z + stored.z) * brickmapSize.x + stored.x);
+        uint brick = brickCells[gridCell];
+        if (brick != kEmptyBrick) {
+            float brickExit = min(min(tNext.x, tNext.y), min(tNext.z, tFar));
+            float brickDistance = distance;
+            vec3 brickNormal = normal;
+            // The level follows the distance of the brick to the camera, not
+            // along the ray, so shadow and bounce rays see the same surface
+            // as camera rays. Cells away from the camera have no full
+            // resolution data at all.
+            ivec3 brickOrigin = brickmapOrigin.xyz + cell * kBrickSize;
+            int level = getBrickLevel(length(vec3(brickOrigin) + 0.5f * float(kBrickSize) - cameraPosition));
+            if (brick == kCoarseBrick) {
+                level = max(level, 1);
+            }
+            if (traverseBrick(rayOrigin, rayDirection, inverseDirection, brick, gridCell, level, brickOrigin, brickExit, brickDistance, brickNormal, block)) {
+                distance = brickDistance;
+                normal = brickNormal;
+                return true;
+            }
+        }
+
+        if (tNext.x < tNext.y && tNext.x < tNext.z) {
+            cell.x += step.x;
+            distance = tNext.x;
+            tNext.x += tDelta.x;
+            normal = vec3(-step.x, 0, 0);
+        } else if (tNext.y < tNext.z) {
+            cell.y += step.y;
+            distance = tNext.y;
+            tNext.y += tDelta.y;
+            normal = vec3(0, -step.y, 0);
+        } else {
+            cell.z += step.z;
+            distance = tNext.z;
+            tNext.z += tDelta.z;
+            normal = vec3(0, 0, -step.z);
+        }
+
+        if (distance > tFar || any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, brickmapSize.xyz))) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool traverseBlocks(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance,
+    out float distance,
+    out vec3 normal,
+    out uint block
+) {
+    if (voxelWorld == 2) {
+        return traverseBrickmap(rayOrigin, rayDirection, maxDistance, distance, normal, block);
+    }
+    return traverseVoxels(rayOrigin, rayDirection, maxDistance, distance, normal, block);
+}
+
+// Blocks map to materials in order, block 1 uses the first one. Texture
+// coordinates span one block, so the texel density is that of the texture.
+HitResult traceVoxels(
+    in vec3 rayOrigin,
+    in vec3 rayDirection
+) {
+    float distance;
+    vec3 normal;
+    uint block;
+    if (!traverseBlocks(rayOrigin, rayDirection, 100000.0f, distance, normal, block)) {
+        return missHit();
+    }
+
+    vec3 position = rayOrigin + rayDirection * distance;
+    vec2 texcoord;
+    if (normal.x != 0.0f) {
+        texcoord = fract(position.zy);
+    } else if (normal.y != 0.0f) {
+        texcoord = fract(position.xz);
+    } else {
+        texcoord = fract(position.xy);
+    }
+
+    // Blocks without a material of their own fall back to the first one.
+    uint material = block - 1u < uint(materialCount) ? block - 1u : 0u;
+    return createHit(distance, normal, position, texcoord, material, 0.0f);
+}
+
+HitResult trace(
+    in vec3 rayOrigin,
+    in vec3 rayDirection
+) {
+    if (voxelWorld != 0) {
+        return traceVoxels(rayOrigin, rayDirection);
+    }
+    return traceTriangles(rayOrigin, rayDirection);
+}
+
+float intersectSphere(in vec3 rayOrigin, in vec3 rayDirection, in vec3 center, in float radius) {
+    vec3 oc = rayOrigin - center;
+    float a = dot(rayDirection, rayDirection);
+    float b = dot(oc, rayDirection);
+    float c = dot(oc, oc) - radius * radius;
+    float h = b * b - a * c;
+    if (h < 0.0f) {
+        return -1.0f;
+    }
+    h = sqrt(h);
+    if (-b - h > 0.0f) {
+        return (-b - h) / a;
+    }
+    return (-b + h) / a;
+}
+
+bool intersectBounds(in vec3 rayOrigin, in vec3 inverseDirection, in vec3 boundsMin, in vec3 boundsMax, in float maxDistance) {
+    vec3 t0 = (boundsMin - rayOrigin) * inverseDirection;
+    vec3 t1 = (boundsMax - rayOrigin) * inverseDirection;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+    float tNear = max(max(tmin.x, tmin.y), max(tmin.z, 0.0f));
+    float tFar = min(min(tmax.x, tmax.y), min(tmax.z, maxDistance));
+    return tNear <= tFar;
+}
+
+// Scene lights are emissive spheres, paths that hit one end there. The light
+// tree doubles as a BVH so that rays do not test every light.
+float traceLights(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance,
+    out int lightIndex
+) {
+    lightIndex = -1;
+    if (lightCount == 0) {
+        return maxDistance;
+    }
+
+    int stack[32];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    vec3 inverseDirection = 1.0f / rayDirection;
+
+    float distance = maxDistance;
+    while (stackSize > 0) {
+        int index = stack[--stackSize];
+        LightTreeNode node = lightNodes[index];
+        if (!intersectBounds(rayOrigin, inverseDirection, node.boundsMin, node.boundsMax, distance)) {
+            continue;
+        }
+
+        if (node.lightIndex >= 0) {
+            float d = intersectSphere(rayOrigin, rayDirection, lights[node.lightIndex].position, lights[node.lightIndex].radius);
+            if (d > 0.0f && d < distance) {
+                distance = d;
+                lightIndex = node.lightIndex;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.rightChild;
+        stack[stackSize++] = index + 1;
+    }
+    return distance;
+}
+
+bool isOccluded(
+    in vec3 rayOrigin,
+    in vec3 rayDirection,
+    in float maxDistance
+) {
+    // Lights block shadow rays like they end paths. The light a ray was aimed
+    // at lies at maxDistance and is left out by the margin.
+    int lightIndex;
+    traceLights(rayOrigin, rayDirection, maxDistance * (1.0f - 1e-4f), lightIndex);
+    if (lightIndex >= 0) {
+        return true;
+    }
+
+    if (voxelWorld != 0) {
+        float distance;
+        vec3 normal;
+        uint block;
+        return traverseBlocks(rayOrigin, rayDirection, maxDistance, distance, normal, block);
+    }
+    return isTriangleOccluded(rayOrigin, rayDirection, maxDistance);
+}
+
+vec3 getLightRadiance(in Light light) {
+    return light.color * light.brightness * light.intensity;
+}
+
+// Estimated contribution of a subtree: its power over the squared distance,
+// clamped by the node size so that nodes around the point stay comparable.
+float getLightNodeImportance(in LightTreeNode node, in vec3 position) {
+    vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+    vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+    vec3 d = center - position;
+    return node.power / max(dot(d, d), dot(extent, extent));
+}
+
+float getLightNodeLeftProbability(in int index, in vec3 position) {
+    float left = getLightNodeImportance(lightNodes[index + 1], position);
+    float right = getLightNodeImportance(lightNodes[lightNodes[index].rightChild], position);
+    if (left + right <= 0.0f) {
+        return 0.5f;
+    }
+    return left / (left + right);
+}
+
+// Walks the light tree picking children proportionally to their importance,
+// the random number is rescaled at every level instead of drawing a new one.
+int selectLight(in vec3 position, out float pdf) {
+    if (lightTree == 0) {
+        pdf = 1.0f / float(lightCount);
+        return min(int(nextRandom() * float(lightCount)), lightCount - 1);
+    }
+
+    pdf = 1.0f;
+
+    float u = nextRandom();
+    int index = 0;
+    while (lightNodes[index].lightIndex < 0) {
+        float p = getLightNodeLeftProbability(index, position);
+        if (u < p) {
+            u /= p;
+            pdf *= p;
+            index = index + 1;
+        } else {
+            u = (u - p) / (1.0f - p);
+            pdf *= 1.0f - p;
+            index = lightNodes[index].rightChild;
+        }
+    }
+    return lightNodes[index].lightIndex;
+}
+
+float getLightSelectionPdf(in int lightIndex, in vec3 position) {
+    if (lightTree == 0) {
+        return 1.0f / float(lightCount);
+    }
+
+    int leaf = lightLeaves[lightIndex];
+
+    float pdf = 1.0f;
+    int index = 0;
+    while (index != leaf) {
+        float p = getLightNodeLeftProbability(index, position);
+        if (leaf < lightNodes[index].rightChild) {
+            pdf *= p;
+            index = index + 1;
+        } else {
+            pdf *= 1.0f - p;
+            index = lightNodes[index].rightChild;
+        }
+    }
+    return pdf;
+}
+
+float getLightConePdf(in Light light, in vec3 position) {
+    vec3 d = light.position - position;
+    float sinMax2 = light.radius * light.radius / dot(d, d);
+    if (sinMax2 >= 1.0f) {
+        return 0.0f;
+    }
+    float cosMax = sqrt(1.0f - sinMax2);
+    return 1.0f / (2.0f * kPI * (1.0f - cosMax));
+}
+
+// Solid angle pdf of sampling a light from a point, including the chance of
+// selecting that light.
+float getLightPdf(in int lightIndex, in vec3 position) {
+    return getLightConePdf(lights[lightIndex], position) * getLightSelectionPdf(lightIndex, position);
+}
+
+float powerHeuristic(in float pdf, in float otherPdf) {
+    return pdf * pdf / (pdf * pdf + otherPdf * otherPdf);
+}
+
+// Weight of radiance found by BSDF sampling, camera rays and paths traced
+// without light sampling keep all of it.
+float getLightMisWeight(in int lightIndex, in vec3 position, in float bsdfPdf) {
+    if (nextEventEstimation == 0 || bsdfPdf <= 0.0f) {
+        return 1.0f;
+    }
+    return powerHeuristic(bsdfPdf, getLightPdf(lightIndex, position));
+}
+
+// Angle between the camera rays of neighbouring pixels, a ray cone starts at
+// the camera and widens by this much per unit of distance. Flat geometry
+// keeps the spread unchanged after a bounce.
+float getPixelSpreadAngle(ivec2 coord) {
+    int x = coord.x + 1 < renderWidth ? coord.x + 1 : max(coord.x - 1, 0);
+    vec3 a = normalize(rayDirections[coord.y * renderWidth + coord.x].xyz);
+    vec3 b = normalize(rayDirections[coord.y * renderWidth + x].xyz);
+    return length(cross(a, b));
+}
+
+// Picks the mip level whose texels match the footprint of a ray cone of the
+// given width at the hit, compute shaders have no derivatives to do it.
+vec3 sampleAlbedo(in HitResult hit, in float coneWidth, in vec3 rayDirection) {
+    vec3 albedo = materialAlbedos[hit.Material].rgb;
+    ivec2 materialTexture = materialTextures[hit.Material];
+    if (materialTexture.x >= 0) {
+        vec2 size = vec2(textureSize(sampler2D(textures[nonuniformEXT(materialTexture.x)], mainSampler), 0));
+        float cosTheta = max(abs(dot(normalize(hit.Normal), normalize(rayDirection))), 1e-3f);
+        float lod = hit.TexelDensity + 0.5f * log2(size.x * size.y) + log2(coneWidth / cosTheta);
+        int level = int(clamp(lod, 0.0f, float(materialTexture.y - 1)) + 0.5f);
+        albedo *= textureLod(sampler2D(textures[nonuniformEXT(materialTexture.x + level)], mainSampler), hit.TexCoord, 0.0f).rgb;
+    }
+    return albedo;
+}
+
+// The sun is a delta light, it can only be reached by explicit sampling.
+vec3 sampleSunLight(in vec3 albedo, in vec3 normal) {
+    return albedo * max(dot(normal, -kLightDirection), 0.0f) * kLightIntensity;
+}
+
+// Picks one scene light and samples a direction inside the cone it subtends.
+// The returned contribution is MIS-weighted but not yet tested for occlusion.
+vec3 sampleSceneLight(
+    in vec3 position,
+    in vec3 albedo,
+    in vec3 normal,
+    out vec3 direction,
+    out float distance
+) {
+    distance = -1.0f;
+    if (nextEventEstimation == 0 || lightCount == 0) {
+        return vec3(0.0f);
+    }
+
+    float selectionPdf;
+    Light light = lights[selectLight(position, selectionPdf)];
+
+    float pdf = getLightConePdf(light, position) * selectionPdf;
+    if (pdf <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    vec3 d = light.position - position;
+    float cosMax = sqrt(1.0f - light.radius * light.radius / dot(d, d));
+    float cosTheta = 1.0f - nextRandom() * (1.0f - cosMax);
+    float sinTheta = sqrt(max(1.0f - cosTheta * cosTheta, 0.0f));
+    float phi = 2.0f * kPI * nextRandom();
+
+    vec3 w = normalize(d);
+    vec3 tangent = normalize(cross(w, abs(w.x) > 0.9f ? vec3(0, 1, 0) : vec3(1, 0, 0)));
+    vec3 bitangent = cross(w, tangent);
+    direction = normalize(tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + w * cosTheta);
+
+    float cosine = dot(normal, direction);
+    if (cosine <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    distance = intersectSphere(position, direction, light.position, light.radius);
+    if (distance <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    float bsdfPdf = cosine / kPI;
+    return albedo / kPI * getLightRadiance(light) * cosine / pdf * powerHeuristic(pdf, bsdfPdf);
+}
+
+// Russian roulette keeps the estimator unbiased while most paths stop once
+// their throughput no longer matters.
+bool survivesRoulette(inout vec3 throughput, in int depth) {
+    if (depth < rouletteDepth) {
+        return true;
+    }
+    float survival = clamp(max(throughput.r, max(throughput.g, throughput.b)), 0.05f, 0.95f);
+    if (nextRandom() > survival) {
+        return false;
+    }
+    throughput /= survival;
+    return true;
+}
+
+void storeFeatures(in ivec2 coord, in vec4 normalDepth, in vec4 albedoColor) {
+    imageStore(normalDepthTexture, coord, normalDepth);
+    imageStore(albedoTexture, coord, albedoColor);
+}
+
+void accumulateSample(in ivec2 coord, in vec4 newColor) {
+    if (accumulateFrame <= 1) {
+        vec4 finalColor = vec4(pow(newColor.rgb, vec3(2.2f)), newColor.a);
+
+        imageStore(accumulateTexture, coord, newColor);
+        imageStore(averrageTexture, coord, finalColor);
+    } else {
+        vec4 oldColor = imageLoad(accumulateTexture, coord);
+
+        // Alpha counts the samples, interleaved pixels get fewer than accumulateFrame.
+        vec4 accumulateColor = newColor + oldColor;
+        vec4 averrageColor = accumulateColor / accumulateColor.a;
+        vec4 finalColor = vec4(pow(averrageColor.rgb, vec3(2.2f)), averrageColor.a);
+
+        imageStore(accumulateTexture, coord, accumulateColor);
+        imageStore(averrageTexture, coord, finalColor);
+    }
+}
+
+#endif
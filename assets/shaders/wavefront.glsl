@@ -0,0 +1,91 @@
+#ifndef VFX_WAVEFRONT
+#define VFX_WAVEFRONT
+
+#include "raytrace.glsl"
+
+// Wavefront tracing keeps one path per pixel in memory and runs every stage
+// as its own dispatch over a compacted queue of path indices.
+
+struct PathState {
+    vec3  origin;
+    float hitDistance;
+    vec3  direction;
+    uint  rng;
+    vec3  throughput;
+    int   pixel;
+    vec3  radiance;
+    int   bounce;
+    vec3  hitNormal;
+    float bsdfPdf;
+    vec3  sunConnection;
+    float lightDistance;
+    vec3  lightConnection;
+    uint  hitMaterial;
+    vec3  lightDirection;
+    float hitTexelDensity;
+    vec2  hitTexCoord;
+    float coneWidth;
+    float coneSpread;
+};
+
+layout(set = 0, binding = 9) buffer path_state_data {
+    PathState paths[];
+};
+
+// Every queue starts with the indirect dispatch arguments for the stage that
+// consumes it, groupsX grows by one whenever an append starts a new workgroup.
+layout(set = 0, binding = 10) buffer ray_queue_data {
+    uint count;
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint items[];
+} rayQueue;
+
+layout(set = 0, binding = 11) buffer hit_queue_data {
+    uint count;
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint items[];
+} hitQueue;
+
+layout(set = 0, binding = 12) buffer connect_queue_data {
+    uint count;
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint items[];
+} connectQueue;
+
+const uint kQueueGroupSize = 64;
+
+void pushRay(uint path) {
+    uint index = atomicAdd(rayQueue.count, 1u);
+    rayQueue.items[index] = path;
+    if (index % kQueueGroupSize == 0) {
+        atomicAdd(rayQueue.groupsX, 1u);
+    }
+}
+
+void pushHit(uint path) {
+    uint index = atomicAdd(hitQueue.count, 1u);
+    hitQueue.items[index] = path;
+    if (index % kQueueGroupSize == 0) {
+        atomicAdd(hitQueue.groupsX, 1u);
+    }
+}
+
+void pushConnection(uint path) {
+    uint index = atomicAdd(connectQueue.count, 1u);
+    connectQueue.items[index] = path;
+    if (index % kQueueGroupSize == 0) {
+        atomicAdd(connectQueue.groupsX, 1u);
+    }
+}
+
+ivec2 getPathCoord(in PathState path) {
+    return ivec2(path.pixel % renderWidth, path.pixel / renderWidth);
+}
+
+#endif
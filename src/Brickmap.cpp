@@ -0,0 +1,267 @@
+#include "Brickmap.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static constexpr i32 kBricksPerSection = ChunkSection::kSize / Brickmap::kBrickSize;
+static constexpr size_t kHeaderWords = sizeof(BrickmapHeader) / sizeof(u32);
+static constexpr auto kLodOffsets = std::array{0, 64, 72};
+
+// Each level from the one below it, the upper half of the 2x2x2 children is
+// looked at first so the coarse voxel shows the block on top.
+static void buildLods(const u8* blocks, u8* lods) {
+    auto source = blocks;
+    for (i32 level = 0; level < Brickmap::kLodLevels; ++level) {
+        auto size = Brickmap::kBrickSize >> (level + 1);
+        auto target = lods + kLodOffsets[size_t(level)];
+        for (i32 y = 0; y < size; ++y) {
+            for (i32 z = 0; z < size; ++z) {
+                for (i32 x = 0; x < size; ++x) {
+                    auto block = u8(0);
+                    for (i32 i = 7; i >= 0 && block == 0; --i) {
+                        auto cx = x * 2 + (i & 1);
+                        auto cy = y * 2 + ((i >> 2) & 1);
+                        auto cz = z * 2 + ((i >> 1) & 1);
+                        block = source[(cy * size * 2 + cz) * size * 2 + cx];
+                    }
+                    target[(y * size + z) * size + x] = block;
+                }
+            }
+        }
+        source = target;
+    }
+}
+
+// Positive remainder, cells wrap the same way on both sides of zero.
+static auto wrap(i32 value, i32 size) -> i32 {
+    return ((value % size) + size) % size;
+}
+
+Brickmap::Brickmap(const World& world, const ChunkPosition& center, i32 viewDistance, i32 detailDistance, i32 height)
+    : center(center), viewDistance(viewDistance), detailDistance(std::min(detailDistance, viewDistance)) {
+    min = ChunkPosition{center.x - viewDistance, center.z - viewDistance};
+    max = ChunkPosition{center.x + viewDistance - 1, center.z + viewDistance - 1};
+    size = glm::ivec3(
+        viewDistance * 2 * kBricksPerSection,
+        (std::min(height, Chunk::kHeight) + kBrickSize - 1) / kBrickSize,
+        viewDistance * 2 * kBricksPerSection
+    );
+
+    // The detail area is a square of chunks clipped to the window.
+    auto count = size_t(size.x) * size_t(size.y) * size_t(size.z);
+    auto detailChunks = size_t(std::min(this->detailDistance * 2 + 1, viewDistance * 2));
+    auto capacity = detailChunks * detailChunks * size_t(kBricksPerSection * kBricksPerSection * size.y);
+    cells.resize(kHeaderWords + count, kEmptyBrick);
+    bricks.resize(capacity * kBrickWords);
+    lods.resize(count * kLodWords);
+    freeBricks.reserve(capacity);
+    for (auto brick = capacity; brick > 0; --brick) {
+        freeBricks.emplace_back(u32(brick - 1));
+    }
+
+    writeHeader();
+    for (i32 cz = min.z; cz <= max.z; ++cz) {
+        for (i32 cx = min.x; cx <= max.x; ++cx) {
+            if (auto chunk = world.getChunk(ChunkPosition{cx, cz})) {
+                writeChunk(chunk, ChunkPosition{cx, cz});
+            }
+        }
+    }
+    clearDirty();
+}
+
+auto Brickmap::recenter(const ChunkPosition& position) -> std::vector<ChunkPosition> {
+    auto oldCenter = center;
+    auto oldMin = min;
+    auto oldMax = max;
+    center = position;
+    min = ChunkPosition{center.x - viewDistance, center.z - viewDistance};
+    max = ChunkPosition{center.x + viewDistance - 1, center.z + viewDistance - 1};
+
+    auto wasDetailed = [&](const ChunkPosition& chunk) {
+        return std::max(std::abs(chunk.x - oldCenter.x), std::abs(chunk.z - oldCenter.z)) <= detailDistance;
+    };
+
+    // Columns that left share their cells with the ones that entered. Both
+    // free their bricks before any chunk of the new detail area takes one.
+    for (i32 cz = oldMin.z; cz <= oldMax.z; ++cz) {
+        for (i32 cx = oldMin.x; cx <= oldMax.x; ++cx) {
+            auto chunk = ChunkPosition{cx, cz};
+            if (!contains(chunk)) {
+                writeChunk(nullptr, chunk);
+            } else if (wasDetailed(chunk) && !isDetailed(chunk)) {
+                dropDetail(chunk);
+            }
+        }
+    }
+
+    auto entered = std::vector<ChunkPosition>();
+    for (i32 cz = min.z; cz <= max.z; ++cz) {
+        for (i32 cx = min.x; cx <= max.x; ++cx) {
+            auto chunk = ChunkPosition{cx, cz};
+            auto inside = cx >= oldMin.x && cx <= oldMax.x && cz >= oldMin.z && cz <= oldMax.z;
+            if (!inside || (isDetailed(chunk) && !wasDetailed(chunk))) {
+                entered.emplace_back(chunk);
+            }
+        }
+    }
+    writeHeader();
+    return entered;
+}
+
+void Brickmap::updateChunk(const World& world, const ChunkPosition& position) {
+    if (contains(position)) {
+        writeChunk(world.getChunk(position), position);
+    }
+}
+
+auto Brickmap::getCenter() const -> const ChunkPosition& {
+    return center;
+}
+
+auto Brickmap::contains(const ChunkPosition& position) const -> bool {
+    return position.x >= min.x && position.x <= max.x && position.z >= min.z && position.z <= max.z;
+}
+
+auto Brickmap::isDetailed(const ChunkPosition& position) const -> bool {
+    return std::max(std::abs(position.x - center.x), std::abs(position.z - center.z)) <= detailDistance;
+}
+
+void Brickmap::dropDetail(const ChunkPosition& position) {
+    for (i32 by = 0; by < size.y; ++by) {
+        for (i32 bz = 0; bz < kBricksPerSection; ++bz) {
+            for (i32 bx = 0; bx < kBricksPerSection; ++bx) {
+                auto cell = getCell(position, bx, by, bz);
+                if (cells[cell] < kCoarseBrick) {
+                    setCell(cell, kCoarseBrick);
+                }
+            }
+        }
+    }
+}
+
+auto Brickmap::getCell(const ChunkPosition& position, i32 bx, i32 by, i32 bz) const -> size_t {
+    auto x = wrap(position.x * kBricksPerSection + bx, size.x);
+    auto z = wrap(position.z * kBricksPerSection + bz, size.z);
+    return kHeaderWords + (size_t(by) * size_t(size.z) + size_t(z)) * size_t(size.x) + size_t(x);
+}
+
+void Brickmap::writeHeader() {
+    auto header = BrickmapHeader{
+        .origin = glm::ivec4(min.getBlockPositionX(0), 0, min.getBlockPositionZ(0), 0),
+        .size = glm::ivec4(size.x, size.y, size.z, 0),
+        .offset = glm::ivec4(wrap(min.x * kBricksPerSection, size.x), 0, wrap(min.z * kBricksPerSection, size.z), 0)
+    };
+    std::memcpy(cells.data(), &header, sizeof(BrickmapHeader));
+    for (u32 word = 0; word < kHeaderWords; ++word) {
+        dirtyCells.emplace_back(word);
+    }
+}
+
+void Brickmap::setCell(size_t cell, u32 brick) {
+    if (cells[cell] == brick) {
+        return;
+    }
+    if (cells[cell] < kCoarseBrick) {
+        freeBricks.emplace_back(cells[cell]);
+    }
+    cells[cell] = brick;
+    dirtyCells.emplace_back(u32(cell));
+}
+
+void Brickmap::writeChunk(const Chunk* chunk, const ChunkPosition& position) {
+    auto detailed = isDetailed(position);
+    auto blocks = std::array<u8, kBrickVolume>();
+    auto levels = std::array<u8, kLodBytes>();
+    for (i32 by = 0; by < size.y; ++by) {
+        auto section = chunk != nullptr ? chunk->getSection(by / kBricksPerSection) : nullptr;
+
+        for (i32 bz = 0; bz < kBricksPerSection; ++bz) {
+            for (i32 bx = 0; bx < kBricksPerSection; ++bx) {
+                auto solid = false;
+                if (section != nullptr) {
+                    for (i32 y = 0; y < kBrickSize; ++y) {
+                        for (i32 z = 0; z < kBrickSize; ++z) {
+                            for (i32 x = 0; x < kBrickSize; ++x) {
+                                auto block = chunk->getBlock(bx * kBrickSize + x, by * kBrickSize + y, bz * kBrickSize + z);
+                                blocks[size_t((y * kBrickSize + z) * kBrickSize + x)] = u8(std::min(block, BlockId(255)));
+                                solid |= block != 0;
+                            }
+                        }
+                    }
+                }
+
+                auto cell = getCell(position, bx, by, bz);
+                if (!solid) {
+                    setCell(cell, kEmptyBrick);
+                    continue;
+                }
+
+                auto index = cell - kHeaderWords;
+                buildLods(blocks.data(), levels.data());
+                if (std::memcmp(lods.data() + index * kLodWords, levels.data(), kLodBytes) != 0) {
+                    std::memcpy(lods.data() + index * kLodWords, levels.data(), kLodBytes);
+                    dirtyLods.emplace_back(u32(index));
+                }
+
+                if (!detailed) {
+                    setCell(cell, kCoarseBrick);
+                    continue;
+                }
+
+                auto brick = cells[cell];
+                if (brick >= kCoarseBrick) {
+                    // Every cell of the detail area has a brick, the free
+                    // list cannot be empty.
+                    brick = freeBricks.back();
+                    freeBricks.pop_back();
+                    setCell(cell, brick);
+                } else if (std::memcmp(bricks.data() + size_t(brick) * kBrickWords, blocks.data(), kBrickVolume) == 0) {
+                    continue;
+                }
+
+                std::memcpy(bricks.data() + size_t(brick) * kBrickWords, blocks.data(), kBrickVolume);
+                dirtyBricks.emplace_back(brick);
+            }
+        }
+    }
+}
+
+auto Brickmap::getCells() const -> const std::vector<u32>& {
+    return cells;
+}
+
+auto Brickmap::getBricks() const -> const std::vector<u32>& {
+    return bricks;
+}
+
+auto Brickmap::getLods() const -> const std::vector<u32>& {
+    return lods;
+}
+
+auto Brickmap::getBrickCount() const -> size_t {
+    return bricks.size() / kBrickWords - freeBricks.size();
+}
+
+auto Brickmap::getMemoryUsage() const -> size_t {
+    return (cells.size() + bricks.size() + lods.size()) * sizeof(u32);
+}
+
+auto Brickmap::getDirtyCells() const -> const std::vector<u32>& {
+    return dirtyCells;
+}
+
+auto Brickmap::getDirtyBricks() const -> const std::vector<u32>& {
+    return dirtyBricks;
+}
+
+auto Brickmap::getDirtyLods() const -> const std::vector<u32>& {
+    return dirtyLods;
+}
+
+void Brickmap::clearDirty() {
+    dirtyCells.clear();
+    dirtyBricks.clear();
+    dirtyLods.clear();
+}
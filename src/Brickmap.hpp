@@ -0,0 +1,132 @@
+#pragma once
+
+#include "World.hpp"
+
+#include <array>
+#include <vector>
+
+// Mirrors the header of brickmap_data in raytrace.glsl.
+struct BrickmapHeader {
+    int4 origin;
+    int4 size;
+    // Where origin lands in the wrapped cell storage.
+    int4 offset;
+};
+
+// Two-level voxel structure for the traversal in raytrace.glsl. A coarse grid
+// with one cell per 8x8x8 blocks points into a pool of bricks, cells without
+// a solid block point nowhere and are skipped by the traversal in one step.
+// Bricks store one byte per block like VoxelGrid.
+//
+// Every solid cell also has copies at 2x, 4x and 8x coarser resolution, which
+// the traversal switches to with distance. A coarse voxel is solid when any
+// block it covers is, so distant terrain never gets holes, and takes the
+// topmost of them. Only chunks within the detail distance of the center keep
+// full resolution bricks, farther cells are kCoarseBrick and cost just their
+// coarse levels.
+//
+// The grid is a fixed window of chunks around a center. Cells are addressed
+// modulo the window size, so moving the center only clears the columns that
+// left and leaves the columns that entered to be written like edited chunks.
+// The pool has a brick for every cell of the detail area and never runs out.
+// The cells, bricks and levels touched since clearDirty are recorded for
+// uploading just those words.
+struct Brickmap {
+public:
+    static constexpr i32 kBrickSize = 8;
+    static constexpr i32 kBrickVolume = kBrickSize * kBrickSize * kBrickSize;
+    static constexpr i32 kBrickWords = kBrickVolume / 4;
+    static constexpr u32 kEmptyBrick = 0xFFFFFFFF;
+    static constexpr u32 kCoarseBrick = 0xFFFFFFFE;
+
+    // 4x4x4, 2x2x2 and 1 voxel behind each other, padded to whole words.
+    static constexpr i32 kLodLevels = 3;
+    static constexpr i32 kLodBytes = 80;
+    static constexpr i32 kLodWords = kLodBytes / 4;
+
+public:
+    // Covers viewDistance chunks on each side of center and blocks below
+    // height, which is rounded up to whole bricks. Chunks at most
+    // detailDistance chunks from center along either axis have full detail.
+    Brickmap(const World& world, const ChunkPosition& center, i32 viewDistance, i32 detailDistance, i32 height);
+
+public:
+    // Moves the window and returns the chunks that entered it or its detail
+    // area. They read as air or coarse until they are passed to updateChunk.
+    auto recenter(const ChunkPosition& center) -> std::vector<ChunkPosition>;
+
+    // Rebuilds the bricks of one chunk from the world, chunks outside the
+    // window are ignored.
+    void updateChunk(const World& world, const ChunkPosition& position);
+
+    [[nodiscard]]
+    auto getCenter() const -> const ChunkPosition&;
+
+    // Header followed by the brick index of every cell.
+    [[nodiscard]]
+    auto getCells() const -> const std::vector<u32>&;
+
+    // The whole pool, unused bricks are zero.
+    [[nodiscard]]
+    auto getBricks() const -> const std::vector<u32>&;
+
+    // Coarse levels of every cell, kLodWords each.
+    [[nodiscard]]
+    auto getLods() const -> const std::vector<u32>&;
+
+    [[nodiscard]]
+    auto getBrickCount() const -> size_t;
+
+    [[nodiscard]]
+    auto getMemoryUsage() const -> size_t;
+
+    // Word offsets into getCells of the cells changed since clearDirty.
+    [[nodiscard]]
+    auto getDirtyCells() const -> const std::vector<u32>&;
+
+    // Indices of the bricks changed since clearDirty.
+    [[nodiscard]]
+    auto getDirtyBricks() const -> const std::vector<u32>&;
+
+    // Cells whose coarse levels changed since clearDirty, counted without
+    // the header.
+    [[nodiscard]]
+    auto getDirtyLods() const -> const std::vector<u32>&;
+
+    void clearDirty();
+
+private:
+    [[nodiscard]]
+    auto contains(const ChunkPosition& position) const -> bool;
+
+    [[nodiscard]]
+    auto isDetailed(const ChunkPosition& position) const -> bool;
+
+    // Turns the full resolution bricks of a chunk into coarse cells.
+    void dropDetail(const ChunkPosition& position);
+
+    // Word offset into cells of a brick of the chunk at position.
+    [[nodiscard]]
+    auto getCell(const ChunkPosition& position, i32 bx, i32 by, i32 bz) const -> size_t;
+
+    void writeHeader();
+    void writeChunk(const Chunk* chunk, const ChunkPosition& position);
+    void setCell(size_t cell, u32 brick);
+
+private:
+    ChunkPosition center = {};
+    ChunkPosition min = {};
+    ChunkPosition max = {};
+    i32 viewDistance = 0;
+    i32 detailDistance = 0;
+    glm::ivec3 size = {};
+
+    std::vector<u32> cells = {};
+    std::vector<u32> bricks = {};
+    std::vector<u32> lods = {};
+    std::vector<u32> freeBricks = {};
+
+    std::vector<u32> dirtyCells = {};
+    std::vector<u32> dirtyBricks = {};
+    std::vector<u32> dirtyLods = {};
+};
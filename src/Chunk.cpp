@@ -0,0 +1,278 @@
+#include "Chunk.hpp"
+
+#include <bit>
+#include <cstring>
+
+// Smallest power-of-two index width that addresses the given number of
+// palette entries, zero for a single entry.
+static auto getRequiredBits(size_t entries) -> u32 {
+    u32 bits = 0;
+    while ((size_t(1) << bits) < entries) {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    return bits;
+}
+
+void ChunkSection::setBlock(i32 x, i32 y, i32 z, BlockId block) {
+    auto index = getIndex(x, y, z);
+    auto current = getPaletteIndex(index);
+    if (palette[current] == block) {
+        return;
+    }
+
+    auto entry = u32(palette.size());
+    for (u32 i = 0; i < palette.size(); ++i) {
+        if (counts[i] != 0 && palette[i] == block) {
+            entry = i;
+            break;
+        }
+        if (counts[i] == 0 && entry == palette.size()) {
+            entry = i;
+        }
+    }
+
+    if (entry == palette.size()) {
+        palette.emplace_back(block);
+        counts.emplace_back(0);
+        if (palette.size() > (size_t(1) << bitsPerBlock)) {
+            auto remap = std::vector<u16>(palette.size());
+            for (u32 i = 0; i < remap.size(); ++i) {
+                remap[i] = u16(i);
+            }
+            repack(getRequiredBits(palette.size()), remap);
+        }
+    } else {
+        palette[entry] = block;
+    }
+
+    counts[current] -= 1;
+    counts[entry] += 1;
+    setPaletteIndex(index, entry);
+    writesSinceRepack += 1;
+
+    if (counts[current] != 0) {
+        return;
+    }
+
+    size_t live = 0;
+    for (auto count : counts) {
+        live += count != 0 ? 1 : 0;
+    }
+    // A single block type collapses right away, otherwise edits that keep
+    // adding and removing one block type would repack on every write.
+    if (live != 1 && writesSinceRepack < u32(kVolume / 16)) {
+        return;
+    }
+    if (getRequiredBits(live) >= bitsPerBlock) {
+        return;
+    }
+
+    auto remap = std::vector<u16>(palette.size());
+    auto compactPalette = std::vector<BlockId>();
+    auto compactCounts = std::vector<u16>();
+    for (u32 i = 0; i < palette.size(); ++i) {
+        if (counts[i] != 0) {
+            remap[i] = u16(compactPalette.size());
+            compactPalette.emplace_back(palette[i]);
+            compactCounts.emplace_back(counts[i]);
+        }
+    }
+    repack(getRequiredBits(compactPalette.size()), remap);
+    palette = std::move(compactPalette);
+    counts = std::move(compactCounts);
+}
+
+auto ChunkSection::getMemoryUsage() const -> size_t {
+    return sizeof(ChunkSection)
+        + palette.capacity() * sizeof(BlockId)
+        + counts.capacity() * sizeof(u16)
+        + words.capacity() * sizeof(u64);
+}
+
+template<typename T>
+static void write(std::vector<u8>& out, const T* data, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    auto offset = out.size();
+    out.resize(offset + sizeof(T) * count);
+    std::memcpy(out.data() + offset, data, sizeof(T) * count);
+}
+
+template<typename T>
+static auto read(std::span<const u8>& in, T* data, size_t count) -> bool {
+    if (in.size() < sizeof(T) * count) {
+        return false;
+    }
+    std::memcpy(data, in.data(), sizeof(T) * count);
+    in = in.subspan(sizeof(T) * count);
+    return true;
+}
+
+void ChunkSection::serialize(std::vector<u8>& out) const {
+    auto bits = u8(bitsPerBlock);
+    auto entries = u16(palette.size());
+    write(out, &bits, 1);
+    write(out, &entries, 1);
+    write(out, palette.data(), palette.size());
+    write(out, words.data(), words.size());
+}
+
+auto ChunkSection::deserialize(std::span<const u8>& in) -> bool {
+    auto bits = u8(0);
+    auto entries = u16(0);
+    if (!read(in, &bits, 1) || !read(in, &entries, 1)) {
+        return false;
+    }
+    if (std::popcount(bits) > 1 || bits > 16 || entries == 0 || entries > kVolume || entries > (size_t(1) << bits)) {
+        return false;
+    }
+
+    palette.resize(entries);
+    if (!read(in, palette.data(), palette.size())) {
+        return false;
+    }
+
+    bitsPerBlock = bits;
+    if (bits == 0) {
+        words = std::vector<u64>();
+        entriesPerWordShift = 0;
+        entriesPerWordMask = 0;
+    } else {
+        auto entriesPerWord = 64 / u32(bits);
+        entriesPerWordShift = u32(std::countr_zero(entriesPerWord));
+        entriesPerWordMask = entriesPerWord - 1;
+        words = std::vector<u64>(kVolume / entriesPerWord);
+        if (!read(in, words.data(), words.size())) {
+            return false;
+        }
+    }
+
+    counts.assign(palette.size(), 0);
+    for (i32 i = 0; i < kVolume; ++i) {
+        auto entry = getPaletteIndex(i);
+        if (entry >= palette.size()) {
+            return false;
+        }
+        counts[entry] += 1;
+    }
+    return true;
+}
+
+void ChunkSection::setPaletteIndex(i32 index, u32 value) {
+    auto shift = u32(index & i32(entriesPerWordMask)) * bitsPerBlock;
+    auto mask = u64((1u << bitsPerBlock) - 1) << shift;
+    auto& word = words[size_t(index) >> entriesPerWordShift];
+    word = (word & ~mask) | (u64(value) << shift);
+}
+
+void ChunkSection::repack(u32 bits, const std::vector<u16>& remap) {
+    writesSinceRepack = 0;
+    if (bits == 0) {
+        bitsPerBlock = 0;
+        words = std::vector<u64>();
+        entriesPerWordShift = 0;
+        entriesPerWordMask = 0;
+        return;
+    }
+
+    auto indices = std::vector<u16>(kVolume);
+    for (i32 i = 0; i < kVolume; ++i) {
+        indices[size_t(i)] = remap[getPaletteIndex(i)];
+    }
+
+    bitsPerBlock = bits;
+    auto entriesPerWord = 64 / bits;
+    entriesPerWordShift = u32(std::countr_zero(entriesPerWord));
+    entriesPerWordMask = entriesPerWord - 1;
+    words = std::vector<u64>(kVolume / entriesPerWord);
+    for (i32 i = 0; i < kVolume; ++i) {
+        words[size_t(i) >> entriesPerWordShift] |= u64(indices[size_t(i)]) << (u32(i & i32(entriesPerWordMask)) * bits);
+    }
+}
+
+Chunk::Chunk(const ChunkPosition& position) : position(position) {}
+
+auto Chunk::getPosition() const -> const ChunkPosition& {
+    return position;
+}
+
+auto Chunk::getBlock(i32 x, i32 y, i32 z) const -> BlockId {
+    auto& section = sections[size_t(y >> 4)];
+    if (!section) {
+        return 0;
+    }
+    return section->getBlock(x, y & 15, z);
+}
+
+void Chunk::setBlock(i32 x, i32 y, i32 z, BlockId block) {
+    auto& section = sections[size_t(y >> 4)];
+    if (!section) {
+        if (block == 0) {
+            return;
+        }
+        section = std::make_unique<ChunkSection>();
+    }
+    section->setBlock(x, y & 15, z, block);
+    if (section->isEmpty()) {
+        section.reset();
+    }
+    modified = true;
+}
+
+auto Chunk::getSection(i32 index) const -> const ChunkSection* {
+    return sections[size_t(index)].get();
+}
+
+auto Chunk::getMemoryUsage() const -> size_t {
+    auto bytes = sizeof(Chunk);
+    for (auto& section : sections) {
+        if (section) {
+            bytes += section->getMemoryUsage();
+        }
+    }
+    return bytes;
+}
+
+auto Chunk::isModified() const -> bool {
+    return modified;
+}
+
+void Chunk::setModified(bool value) {
+    modified = value;
+}
+
+void Chunk::serialize(std::vector<u8>& out) const {
+    auto mask = u16(0);
+    for (i32 i = 0; i < kSectionCount; ++i) {
+        mask |= sections[size_t(i)] ? u16(1u << i) : u16(0);
+    }
+    write(out, &mask, 1);
+    for (auto& section : sections) {
+        if (section) {
+            section->serialize(out);
+        }
+    }
+}
+
+auto Chunk::deserialize(const ChunkPosition& position, std::span<const u8> in) -> std::unique_ptr<Chunk> {
+    auto mask = u16(0);
+    if (!read(in, &mask, 1)) {
+        return nullptr;
+    }
+
+    auto chunk = std::make_unique<Chunk>(position);
+    for (i32 i = 0; i < kSectionCount; ++i) {
+        if ((mask & (1u << i)) == 0) {
+            continue;
+        }
+        auto section = std::make_unique<ChunkSection>();
+        if (!section->deserialize(in)) {
+            return nullptr;
+        }
+        if (!section->isEmpty()) {
+            chunk->sections[size_t(i)] = std::move(section);
+        }
+    }
+    return chunk;
+}
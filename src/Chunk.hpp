@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core.hpp"
+#include "Math.hpp"
+
+#include <span>
+#include <array>
+#include <memory>
+#include <vector>
+
+// Zero is air, every other id is a solid block.
+using BlockId = u16;
+
+// 16x16x16 blocks, x varies fastest, then z, then y. Blocks are stored as
+// indices into a palette of the block ids the section contains, bit-packed
+// into 64-bit words. Index widths are powers of two so an index never
+// straddles two words, a section with a single block id stores no indices.
+struct ChunkSection {
+public:
+    static constexpr i32 kSize = 16;
+    static constexpr i32 kVolume = kSize * kSize * kSize;
+    // Largest output of serialize, the palette never has more entries than
+    // the section has blocks and indices are at most 16 bits.
+    static constexpr size_t kMaxSerializedSize = sizeof(u8) + sizeof(u16) + kVolume * sizeof(BlockId) + kVolume * sizeof(u16);
+
+public:
+    [[nodiscard]]
+    static auto getIndex(i32 x, i32 y, i32 z) -> i32 {
+        return (y << 8) | (z << 4) | x;
+    }
+
+    [[nodiscard]]
+    auto getBlock(i32 x, i32 y, i32 z) const -> BlockId {
+        return palette[getPaletteIndex(getIndex(x, y, z))];
+    }
+
+    void setBlock(i32 x, i32 y, i32 z, BlockId block);
+
+    // True when every block is air.
+    [[nodiscard]]
+    auto isEmpty() const -> bool {
+        return bitsPerBlock == 0 && palette[0] == 0;
+    }
+
+    [[nodiscard]]
+    auto getBitsPerBlock() const -> u32 {
+        return bitsPerBlock;
+    }
+
+    [[nodiscard]]
+    auto getMemoryUsage() const -> size_t;
+
+    // Appends the palette and the packed indices as they are in memory.
+    void serialize(std::vector<u8>& out) const;
+
+    // Reads what serialize wrote and advances past it, false when the data
+    // is malformed.
+    auto deserialize(std::span<const u8>& in) -> bool;
+
+private:
+    [[nodiscard]]
+    auto getPaletteIndex(i32 index) const -> u32 {
+        if (bitsPerBlock == 0) {
+            return 0;
+        }
+        auto shift = u32(index & i32(entriesPerWordMask)) * bitsPerBlock;
+        return u32(words[size_t(index) >> entriesPerWordShift] >> shift) & ((1u << bitsPerBlock) - 1);
+    }
+
+    void setPaletteIndex(i32 index, u32 value);
+    // Rewrites every index through remap with the new width.
+    void repack(u32 bits, const std::vector<u16>& remap);
+
+private:
+    std::vector<BlockId> palette = {0};
+    // Number of blocks that use each palette entry, an entry at zero is
+    // reused before the palette grows.
+    std::vector<u16> counts = {u16(kVolume)};
+    std::vector<u64> words = {};
+    u32 bitsPerBlock = 0;
+    u32 entriesPerWordShift = 0;
+    u32 entriesPerWordMask = 0;
+    // Writes since the width last changed, a narrower width waits until
+    // enough of them paid for the repack.
+    u32 writesSinceRepack = 0;
+};
+
+// A column of sections, sections that were never written stay unallocated
+// and read as air. Coordinates are local to the chunk.
+struct Chunk {
+public:
+    static constexpr i32 kSectionCount = 16;
+    static constexpr i32 kHeight = kSectionCount * ChunkSection::kSize;
+    static constexpr size_t kMaxSerializedSize = sizeof(u16) + kSectionCount * ChunkSection::kMaxSerializedSize;
+
+public:
+    explicit Chunk(const ChunkPosition& position);
+
+public:
+    [[nodiscard]]
+    auto getPosition() const -> const ChunkPosition&;
+
+    [[nodiscard]]
+    auto getBlock(i32 x, i32 y, i32 z) const -> BlockId;
+
+    void setBlock(i32 x, i32 y, i32 z, BlockId block);
+
+    [[nodiscard]]
+    auto getSection(i32 index) const -> const ChunkSection*;
+
+    [[nodiscard]]
+    auto getMemoryUsage() const -> size_t;
+
+    // Set by setBlock, cleared by whoever persisted the chunk.
+    [[nodiscard]]
+    auto isModified() const -> bool;
+
+    void setModified(bool value);
+
+    // Host byte order, the allocated sections one after another.
+    void serialize(std::vector<u8>& out) const;
+
+    // Returns null when the data is malformed.
+    [[nodiscard]]
+    static auto deserialize(const ChunkPosition& position, std::span<const u8> in) -> std::unique_ptr<Chunk>;
+
+private:
+    ChunkPosition position = {};
+    std::array<std::unique_ptr<ChunkSection>, kSectionCount> sections = {};
+    bool modified = false;
+};
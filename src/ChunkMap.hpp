@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Core.hpp"
+#include "Math.hpp"
+
+#include <bit>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// Open-addressing hash map from chunk positions to chunk data. Linear probing
+// over a power-of-two table that is kept at most half full, erasing shifts the
+// entries after the hole back so lookups never have to skip tombstones.
+template<typename T>
+struct ChunkMap {
+public:
+    [[nodiscard]]
+    auto size() const -> size_t {
+        return count;
+    }
+
+    [[nodiscard]]
+    auto find(const ChunkPosition& position) -> T* {
+        return const_cast<T*>(std::as_const(*this).find(position));
+    }
+
+    [[nodiscard]]
+    auto find(const ChunkPosition& position) const -> const T* {
+        if (count == 0) {
+            return nullptr;
+        }
+        for (auto i = getHomeSlot(position); occupied[i] != 0; i = (i + 1) & mask) {
+            if (positions[i] == position) {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Replaces the value if the position is already present.
+    auto insert(const ChunkPosition& position, T value) -> T& {
+        if ((count + 1) * 2 > occupied.size()) {
+            rehash(std::max(occupied.size() * 2, size_t(16)));
+        }
+
+        auto i = getHomeSlot(position);
+        while (occupied[i] != 0 && positions[i] != position) {
+            i = (i + 1) & mask;
+        }
+        if (occupied[i] == 0) {
+            occupied[i] = 1;
+            positions[i] = position;
+            count += 1;
+        }
+        values[i] = std::move(value);
+        return values[i];
+    }
+
+    auto erase(const ChunkPosition& position) -> bool {
+        if (count == 0) {
+            return false;
+        }
+
+        auto i = getHomeSlot(position);
+        while (occupied[i] != 0 && positions[i] != position) {
+            i = (i + 1) & mask;
+        }
+        if (occupied[i] == 0) {
+            return false;
+        }
+
+        // Moves back every entry whose home slot does not lie between the
+        // hole and its current slot.
+        for (auto j = (i + 1) & mask; occupied[j] != 0; j = (j + 1) & mask) {
+            auto home = getHomeSlot(positions[j]);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                positions[i] = positions[j];
+                values[i] = std::move(values[j]);
+                i = j;
+            }
+        }
+
+        occupied[i] = 0;
+        values[i] = T{};
+        count -= 1;
+        return true;
+    }
+
+    void clear() {
+        occupied.clear();
+        positions.clear();
+        values.clear();
+        count = 0;
+        mask = 0;
+        shift = 64;
+    }
+
+    void forEach(auto&& fn) {
+        for (size_t i = 0; i < occupied.size(); ++i) {
+            if (occupied[i] != 0) {
+                fn(positions[i], values[i]);
+            }
+        }
+    }
+
+    void forEach(auto&& fn) const {
+        for (size_t i = 0; i < occupied.size(); ++i) {
+            if (occupied[i] != 0) {
+                fn(positions[i], values[i]);
+            }
+        }
+    }
+
+private:
+    // Fibonacci hashing, the top bits of the product index the table.
+    [[nodiscard]]
+    auto getHomeSlot(const ChunkPosition& position) const -> size_t {
+        auto key = (u64(u32(position.x)) << 32) | u64(u32(position.z));
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    void rehash(size_t capacity) {
+        auto oldOccupied = std::move(occupied);
+        auto oldPositions = std::move(positions);
+        auto oldValues = std::move(values);
+
+        occupied.assign(capacity, 0);
+        positions.assign(capacity, ChunkPosition{});
+        values.clear();
+        values.resize(capacity);
+        count = 0;
+        mask = capacity - 1;
+        shift = u32(64 - std::countr_zero(capacity));
+
+        for (size_t i = 0; i < oldOccupied.size(); ++i) {
+            if (oldOccupied[i] != 0) {
+                insert(oldPositions[i], std::move(oldValues[i]));
+            }
+        }
+    }
+
+private:
+    std::vector<u8> occupied = {};
+    std::vector<ChunkPosition> positions = {};
+    std::vector<T> values = {};
+    size_t count = 0;
+    size_t mask = 0;
+    u32 shift = 64;
+};
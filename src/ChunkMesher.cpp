@@ -0,0 +1,219 @@
+#include "ChunkMesher.hpp"
+
+#include <algorithm>
+
+// Blocks of a chunk with a one block border taken from the neighbours,
+// x varies fastest, then z, then y.
+struct PaddedBlocks {
+public:
+    static constexpr i32 kSize = ChunkSection::kSize + 2;
+
+public:
+    PaddedBlocks(const World& world, const ChunkPosition& position) {
+        auto chunk = world.getChunk(position);
+        if (chunk == nullptr) {
+            return;
+        }
+
+        // Sections above the highest written one are air, so are their faces.
+        for (i32 i = Chunk::kSectionCount - 1; i >= 0; --i) {
+            if (chunk->getSection(i) != nullptr) {
+                height = (i + 1) * ChunkSection::kSize;
+                break;
+            }
+        }
+        blocks.resize(size_t(kSize) * size_t(kSize) * size_t(height + 2));
+
+        for (i32 y = 0; y < height; ++y) {
+            if (chunk->getSection(y >> 4) == nullptr) {
+                y |= 15;
+                continue;
+            }
+            for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                    at(x, y, z) = chunk->getBlock(x, y, z);
+                }
+            }
+        }
+
+        auto copyBorder = [&](i32 dx, i32 dz) {
+            auto neighbour = world.getChunk(ChunkPosition{position.x + dx, position.z + dz});
+            if (neighbour == nullptr) {
+                return;
+            }
+            for (i32 y = 0; y < height; ++y) {
+                for (i32 i = 0; i < ChunkSection::kSize; ++i) {
+                    auto x = dx == 0 ? i : (dx < 0 ? -1 : ChunkSection::kSize);
+                    auto z = dz == 0 ? i : (dz < 0 ? -1 : ChunkSection::kSize);
+                    at(x, y, z) = neighbour->getBlock(x & 15, y, z & 15);
+                }
+            }
+        };
+        copyBorder(-1, 0);
+        copyBorder(+1, 0);
+        copyBorder(0, -1);
+        copyBorder(0, +1);
+    }
+
+public:
+    [[nodiscard]]
+    auto getHeight() const -> i32 {
+        return height;
+    }
+
+    // Coordinates are local to the chunk and may be one block outside it.
+    [[nodiscard]]
+    auto get(i32 x, i32 y, i32 z) const -> BlockId {
+        return blocks[getIndex(x, y, z)];
+    }
+
+    [[nodiscard]]
+    auto get(size_t index) const -> BlockId {
+        return blocks[index];
+    }
+
+    [[nodiscard]]
+    static auto getIndex(i32 x, i32 y, i32 z) -> size_t {
+        return (size_t(y + 1) * kSize + size_t(z + 1)) * kSize + size_t(x + 1);
+    }
+
+    // Index distance between neighbours along x, y and z.
+    [[nodiscard]]
+    static auto getStrides() -> glm::ivec3 {
+        return glm::ivec3(1, kSize * kSize, kSize);
+    }
+
+private:
+
+    auto at(i32 x, i32 y, i32 z) -> BlockId& {
+        return blocks[getIndex(x, y, z)];
+    }
+
+private:
+    i32 height = 0;
+    std::vector<BlockId> blocks = {};
+};
+
+static auto getBlockColor(BlockId block) -> u32 {
+    switch (block) {
+        case 1: return 0xFF808080;
+        case 2: return 0xFF3030C0;
+        case 3: return 0xFF30B0E0;
+        default: return 0xFF000000 | (u32(block) * 0x9E3779B9u >> 8);
+    }
+}
+
+// Emits the quad spanning du and dv from base, wound counter-clockwise seen
+// from the side the normal points to. u, v and the normal axis are cyclic.
+static void addFace(DrawList& out, const glm::vec3& base, const glm::vec3& du, const glm::vec3& dv, bool positive, BlockId block) {
+    if (positive) {
+        out.addQuad(base, base + du, base + du + dv, base + dv, getBlockColor(block));
+    } else {
+        out.addQuad(base, base + dv, base + du + dv, base + du, getBlockColor(block));
+    }
+}
+
+void meshChunkNaive(const World& world, const ChunkPosition& position, DrawList& out) {
+    auto blocks = PaddedBlocks(world, position);
+    auto origin = glm::vec3(f32(position.getBlockPositionX(0)), 0.0f, f32(position.getBlockPositionZ(0)));
+
+    for (i32 y = 0; y < blocks.getHeight(); ++y) {
+        for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+            for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                auto block = blocks.get(x, y, z);
+                if (block == 0) {
+                    continue;
+                }
+                auto index = PaddedBlocks::getIndex(x, y, z);
+                for (i32 d = 0; d < 3; ++d) {
+                    auto u = (d + 1) % 3;
+                    auto v = (d + 2) % 3;
+                    auto du = glm::vec3(0.0f);
+                    auto dv = glm::vec3(0.0f);
+                    du[u] = 1.0f;
+                    dv[v] = 1.0f;
+
+                    for (auto positive : {false, true}) {
+                        auto next = positive ? index + size_t(PaddedBlocks::getStrides()[d]) : index - size_t(PaddedBlocks::getStrides()[d]);
+                        if (blocks.get(next) != 0) {
+                            continue;
+                        }
+                        auto base = origin + glm::vec3(x, y, z);
+                        base[d] += positive ? 1.0f : 0.0f;
+                        addFace(out, base, du, dv, positive, block);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void meshChunkGreedy(const World& world, const ChunkPosition& position, DrawList& out) {
+    auto blocks = PaddedBlocks(world, position);
+    auto origin = glm::vec3(f32(position.getBlockPositionX(0)), 0.0f, f32(position.getBlockPositionZ(0)));
+    auto size = glm::ivec3(ChunkSection::kSize, blocks.getHeight(), ChunkSection::kSize);
+    auto strides = PaddedBlocks::getStrides();
+
+    auto mask = std::vector<BlockId>();
+    for (i32 d = 0; d < 3; ++d) {
+        auto u = (d + 1) % 3;
+        auto v = (d + 2) % 3;
+        mask.resize(size_t(size[u]) * size_t(size[v]));
+
+        for (auto positive : {false, true}) {
+            for (i32 slice = 0; slice < size[d]; ++slice) {
+                // Block ids of the faces in this slice that look into air.
+                auto p = glm::ivec3(0);
+                p[d] = slice;
+                auto offset = positive ? ptrdiff_t(strides[d]) : -ptrdiff_t(strides[d]);
+                auto cell = mask.begin();
+                for (i32 j = 0; j < size[v]; ++j) {
+                    auto index = PaddedBlocks::getIndex(p.x, p.y, p.z) + size_t(j) * size_t(strides[v]);
+                    for (i32 i = 0; i < size[u]; ++i, index += size_t(strides[u])) {
+                        auto block = blocks.get(index);
+                        *cell++ = block != 0 && blocks.get(size_t(ptrdiff_t(index) + offset)) == 0 ? block : 0;
+                    }
+                }
+
+                // Grows each face along u, then along v while whole rows match.
+                for (i32 j = 0; j < size[v]; ++j) {
+                    for (i32 i = 0; i < size[u];) {
+                        auto block = mask[size_t(j) * size_t(size[u]) + size_t(i)];
+                        if (block == 0) {
+                            i += 1;
+                            continue;
+                        }
+
+                        auto w = 1;
+                        while (i + w < size[u] && mask[size_t(j) * size_t(size[u]) + size_t(i + w)] == block) {
+                            w += 1;
+                        }
+                        auto h = 1;
+                        for (; j + h < size[v]; ++h) {
+                            auto row = mask.begin() + ptrdiff_t(size_t(j + h) * size_t(size[u]) + size_t(i));
+                            if (std::any_of(row, row + w, [block](BlockId other) { return other != block; })) {
+                                break;
+                            }
+                        }
+                        for (i32 k = 0; k < h; ++k) {
+                            auto row = mask.begin() + ptrdiff_t(size_t(j + k) * size_t(size[u]) + size_t(i));
+                            std::fill(row, row + w, BlockId(0));
+                        }
+
+                        auto base = origin;
+                        base[d] += f32(slice + (positive ? 1 : 0));
+                        base[u] += f32(i);
+                        base[v] += f32(j);
+                        auto du = glm::vec3(0.0f);
+                        auto dv = glm::vec3(0.0f);
+                        du[u] = f32(w);
+                        dv[v] = f32(h);
+                        addFace(out, base, du, dv, positive, block);
+
+                        i += w;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "World.hpp"
+#include "DrawList.hpp"
+
+// Builds the visible faces of a chunk as world space quads. A face is visible
+// when the block next to it is air, neighbouring chunks are looked up so faces
+// on chunk borders are culled as well, chunks that are not loaded count as air.
+
+// One quad per visible block face.
+void meshChunkNaive(const World& world, const ChunkPosition& position, DrawList& out);
+
+// Visible faces of the same block id in a slice are merged into rectangles.
+void meshChunkGreedy(const World& world, const ChunkPosition& position, DrawList& out);
@@ -0,0 +1,236 @@
+#include "ChunkStreamer.hpp"
+#include "RegionStorage.hpp"
+#include "TerrainGenerator.hpp"
+#include "ThreadPool.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Conservative test of the chunk column against the clip volume, a column
+// is only rejected when all its corners are outside the same plane.
+static auto isInFrustum(const glm::mat4& viewProjectionMatrix, const ChunkPosition& position) -> bool {
+    auto corners = std::array<glm::vec4, 8>();
+    for (i32 i = 0; i < 8; ++i) {
+        corners[size_t(i)] = viewProjectionMatrix * glm::vec4(
+            f32(position.getBlockPositionX((i & 1) != 0 ? ChunkSection::kSize : 0)),
+            f32((i & 2) != 0 ? Chunk::kHeight : 0),
+            f32(position.getBlockPositionZ((i & 4) != 0 ? ChunkSection::kSize : 0)),
+            1.0f
+        );
+    }
+
+    auto outside = [&](auto&& predicate) {
+        return std::all_of(corners.begin(), corners.end(), predicate);
+    };
+    // Depth is zero to one and the projection has no far plane.
+    return !(outside([](const glm::vec4& p) { return p.x < -p.w; })
+          || outside([](const glm::vec4& p) { return p.x > +p.w; })
+          || outside([](const glm::vec4& p) { return p.y < -p.w; })
+          || outside([](const glm::vec4& p) { return p.y > +p.w; })
+          || outside([](const glm::vec4& p) { return p.z < 0.0f; }));
+}
+
+static constexpr i32 kOutOfRange = std::numeric_limits<i32>::max();
+
+static auto getDistanceSquared(const ChunkPosition& a, const ChunkPosition& b) -> i32 {
+    return (a.x - b.x) * (a.x - b.x) + (a.z - b.z) * (a.z - b.z);
+}
+
+ChunkStreamer::ChunkStreamer(const Arc<World>& world, const Arc<ThreadPool>& threadPool, const Arc<TerrainGenerator>& generator, const Arc<RegionStorage>& storage)
+    : world(world), threadPool(threadPool), generator(generator), storage(storage) {
+    maxRequests = std::max(size_t(std::thread::hardware_concurrency()) * 2, size_t(4));
+}
+
+// A failed save loses the edits of this chunk but keeps the game running.
+static auto saveChunk(RegionStorage& storage, const Chunk& chunk) -> bool {
+    try {
+        storage.saveChunk(chunk);
+        return true;
+    } catch (const std::exception& exception) {
+        spdlog::error("Failed to save chunk {} {}: {}", chunk.getPosition().x, chunk.getPosition().z, exception.what());
+        return false;
+    }
+}
+
+ChunkStreamer::~ChunkStreamer() {
+    for (auto& request : requests) {
+        request.cancelled->store(true);
+    }
+    for (auto& request : requests) {
+        request.result.wait();
+    }
+    for (auto& save : saves) {
+        save.saved.wait();
+    }
+    if (storage) {
+        world->getChunks().forEach([&](const ChunkPosition&, const std::unique_ptr<Chunk>& chunk) {
+            if (chunk->isModified()) {
+                saveChunk(*storage, *chunk);
+            }
+        });
+    }
+}
+
+void ChunkStreamer::update(const glm::vec3& cameraPosition, const glm::mat4& viewProjectionMatrix, i32 viewDistance, size_t memoryBudget) {
+    auto center = BlockPosition{i32(glm::floor(cameraPosition.x)), 0, i32(glm::floor(cameraPosition.z))}.getChunkPosition();
+
+    // Evicts chunks out of range and totals what stays loaded.
+    struct Loaded {
+        ChunkPosition position;
+        i32 distance;
+        size_t bytes;
+    };
+    auto loaded = std::vector<Loaded>();
+    auto evictRadius = viewDistance + 1;
+    auto memoryUsage = size_t(0);
+    world->getChunks().forEach([&](const ChunkPosition& position, const std::unique_ptr<Chunk>& chunk) {
+        auto distance = getDistanceSquared(position, center);
+        if (distance > evictRadius * evictRadius) {
+            loaded.emplace_back(Loaded{position, kOutOfRange, 0});
+            return;
+        }
+        auto bytes = chunk->getMemoryUsage();
+        loaded.emplace_back(Loaded{position, distance, bytes});
+        memoryUsage += bytes;
+    });
+
+    // Over budget the farthest chunks go first and the radius follows them
+    // in, it grows back one ring at a time once there is room again.
+    std::sort(loaded.begin(), loaded.end(), [](const Loaded& a, const Loaded& b) {
+        return a.distance < b.distance;
+    });
+    loadRadius = std::min(loadRadius, viewDistance);
+    while (!loaded.empty() && (loaded.back().distance == kOutOfRange || memoryUsage > memoryBudget)) {
+        auto& chunk = loaded.back();
+        if (chunk.distance != kOutOfRange) {
+            memoryUsage -= chunk.bytes;
+            loadRadius = std::min(loadRadius, i32(std::sqrt(f32(chunk.distance))) - 1);
+        }
+        auto evicted = world->takeChunk(chunk.position);
+        if (storage && evicted->isModified()) {
+            auto saved = threadPool->submit([storage = storage, evicted = std::move(evicted)] {
+                return saveChunk(*storage, *evicted);
+            });
+            saves.emplace_back(Save{chunk.position, std::move(saved)});
+        }
+        stats.evicted += 1;
+        loaded.pop_back();
+    }
+    loadRadius = std::max(loadRadius, 0);
+
+    std::erase_if(saves, [&](Save& save) {
+        if (save.saved.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        stats.saved += save.saved.get() ? 1 : 0;
+        return true;
+    });
+
+    // Finished requests are added unless they went stale in the meantime.
+    std::erase_if(requests, [&](Request& request) {
+        auto distance = getDistanceSquared(request.position, center);
+        auto stale = distance > loadRadius * loadRadius;
+        if (stale && !request.cancelled->load()) {
+            request.cancelled->store(true);
+            stats.cancelled += 1;
+        }
+        if (request.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        auto result = request.result.get();
+        if (result.chunk != nullptr && !stale && world->getChunk(request.position) == nullptr) {
+            memoryUsage += result.chunk->getMemoryUsage();
+            world->addChunk(std::move(result.chunk));
+            (result.fromStorage ? stats.loadedFromStorage : stats.generated) += 1;
+        }
+        return true;
+    });
+
+    // Cancelled requests only wait for their job to notice, they do not
+    // hold back new ones.
+    auto inFlight = size_t(std::count_if(requests.begin(), requests.end(), [](const Request& request) {
+        return !request.cancelled->load();
+    }));
+
+    // Candidates in the frustum come first, then by distance.
+    struct Candidate {
+        ChunkPosition position;
+        bool visible;
+        i32 distance;
+    };
+    auto candidates = std::vector<Candidate>();
+    if (memoryUsage < memoryBudget) {
+        for (i32 dz = -loadRadius; dz <= loadRadius; ++dz) {
+            for (i32 dx = -loadRadius; dx <= loadRadius; ++dx) {
+                auto distance = dx * dx + dz * dz;
+                if (distance > loadRadius * loadRadius) {
+                    continue;
+                }
+                auto position = ChunkPosition{center.x + dx, center.z + dz};
+                if (world->getChunk(position) != nullptr) {
+                    continue;
+                }
+                auto saving = std::any_of(saves.begin(), saves.end(), [&](const Save& save) {
+                    return save.position == position;
+                });
+                if (saving) {
+                    continue;
+                }
+                candidates.emplace_back(Candidate{position, isInFrustum(viewProjectionMatrix, position), distance});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.visible != b.visible ? a.visible : a.distance < b.distance;
+    });
+
+    for (auto& candidate : candidates) {
+        if (inFlight >= maxRequests) {
+            break;
+        }
+        auto pending = std::find_if(requests.begin(), requests.end(), [&](const Request& request) {
+            return request.position == candidate.position;
+        });
+        if (pending != requests.end()) {
+            // Revives a request cancelled before its job started.
+            if (pending->cancelled->exchange(false)) {
+                inFlight += 1;
+            }
+            continue;
+        }
+
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        auto result = threadPool->submit([generator = generator, storage = storage, position = candidate.position, cancelled]() -> Result {
+            if (cancelled->load()) {
+                return {};
+            }
+            if (storage) {
+                if (auto chunk = storage->loadChunk(position)) {
+                    return Result{std::move(chunk), true};
+                }
+            }
+            return Result{generator->generate(position), false};
+        });
+        requests.emplace_back(Request{candidate.position, std::move(cancelled), std::move(result)});
+        inFlight += 1;
+    }
+
+    // The next ring is only started once everything inside the current one
+    // arrived, growing earlier lets the shrink above undo it every frame.
+    if (candidates.empty() && inFlight == 0 && memoryUsage < memoryBudget * 9 / 10) {
+        loadRadius = std::min(loadRadius + 1, viewDistance);
+    }
+
+    stats.loadedChunks = world->getChunks().size();
+    stats.pendingRequests = inFlight;
+    stats.memoryUsage = memoryUsage;
+    stats.loadRadius = loadRadius;
+}
+
+auto ChunkStreamer::getStats() const -> const Stats& {
+    return stats;
+}
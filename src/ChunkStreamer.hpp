@@ -0,0 +1,76 @@
+#pragma once
+
+#include "World.hpp"
+
+#include <atomic>
+#include <future>
+
+struct ThreadPool;
+struct RegionStorage;
+struct TerrainGenerator;
+
+// Keeps the chunks around the camera loaded. Missing chunks are generated on
+// the thread pool, those in the view frustum first and nearer ones before
+// farther ones, and only a few requests are in flight at a time so the order
+// follows the camera. Requests for chunks the camera left behind are
+// cancelled, chunks outside the view distance are evicted and when the
+// world still takes more than the budget the farthest chunks go first and
+// the load radius shrinks until memory is back under it.
+//
+// With a storage, evicted chunks that were edited are saved on the thread
+// pool and missing chunks are loaded from it before falling back to the
+// generator. A chunk is not requested again while its save is pending.
+struct ChunkStreamer {
+public:
+    struct Stats {
+        size_t loadedChunks = 0;
+        size_t pendingRequests = 0;
+        size_t memoryUsage = 0;
+        i32 loadRadius = 0;
+        u64 generated = 0;
+        u64 loadedFromStorage = 0;
+        u64 saved = 0;
+        u64 cancelled = 0;
+        u64 evicted = 0;
+    };
+
+public:
+    ChunkStreamer(const Arc<World>& world, const Arc<ThreadPool>& threadPool, const Arc<TerrainGenerator>& generator, const Arc<RegionStorage>& storage = {});
+    // Saves the edited chunks that are still loaded.
+    ~ChunkStreamer();
+
+public:
+    // Called once per frame, viewDistance is in chunks.
+    void update(const glm::vec3& cameraPosition, const glm::mat4& viewProjectionMatrix, i32 viewDistance, size_t memoryBudget);
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats&;
+
+private:
+    struct Result {
+        std::unique_ptr<Chunk> chunk = {};
+        bool fromStorage = false;
+    };
+
+    struct Request {
+        ChunkPosition position = {};
+        std::shared_ptr<std::atomic<bool>> cancelled = {};
+        std::future<Result> result = {};
+    };
+
+    struct Save {
+        ChunkPosition position = {};
+        std::future<bool> saved = {};
+    };
+
+    Arc<World> world;
+    Arc<ThreadPool> threadPool;
+    Arc<TerrainGenerator> generator;
+    Arc<RegionStorage> storage;
+
+    size_t maxRequests = 0;
+    i32 loadRadius = 0;
+    std::vector<Request> requests = {};
+    std::vector<Save> saves = {};
+    Stats stats = {};
+};
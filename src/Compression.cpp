@@ -0,0 +1,148 @@
+#include "Compression.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+static constexpr size_t kMinMatch = 4;
+static constexpr size_t kMaxOffset = 65535;
+static constexpr u32 kHashBits = 14;
+
+static auto readU32(const u8* p) -> u32 {
+    u32 value;
+    std::memcpy(&value, p, sizeof(u32));
+    return value;
+}
+
+static auto getHash(u32 sequence) -> u32 {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// Lengths of 15 and more continue in bytes of 255 and a final remainder.
+static void writeLength(std::vector<u8>& out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        out.emplace_back(u8(255));
+    }
+    out.emplace_back(u8(length));
+}
+
+static void writeSequence(std::vector<u8>& out, const u8* literals, size_t literalLength, size_t matchLength, size_t offset) {
+    auto matchCode = matchLength != 0 ? matchLength - kMinMatch : 0;
+    out.emplace_back(u8((std::min(literalLength, size_t(15)) << 4) | std::min(matchCode, size_t(15))));
+    if (literalLength >= 15) {
+        writeLength(out, literalLength);
+    }
+    if (literalLength != 0) {
+        out.insert(out.end(), literals, literals + literalLength);
+    }
+    if (matchLength == 0) {
+        return;
+    }
+    out.emplace_back(u8(offset));
+    out.emplace_back(u8(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode);
+    }
+}
+
+auto compress(std::span<const u8> input) -> std::vector<u8> {
+    auto out = std::vector<u8>();
+    out.reserve(input.size() / 2 + 16);
+
+    auto table = std::vector<u32>(size_t(1) << kHashBits, 0xFFFFFFFFu);
+    auto data = input.data();
+    auto size = input.size();
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + kMinMatch <= size) {
+        auto sequence = readU32(data + i);
+        auto& slot = table[getHash(sequence)];
+        auto candidate = size_t(slot);
+        slot = u32(i);
+
+        if (candidate == 0xFFFFFFFFu || i - candidate > kMaxOffset || readU32(data + candidate) != sequence) {
+            i += 1;
+            continue;
+        }
+
+        auto length = kMinMatch;
+        while (i + length < size && data[candidate + length] == data[i + length]) {
+            length += 1;
+        }
+        writeSequence(out, data + anchor, i - anchor, length, i - candidate);
+
+        i += length;
+        anchor = i;
+    }
+
+    // Whatever is left goes out as literals, possibly none.
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+auto decompress(std::span<const u8> input, std::span<u8> output) -> bool {
+    auto readLength = [&](size_t& in, size_t length) -> size_t {
+        if (length != 15) {
+            return length;
+        }
+        while (in < input.size()) {
+            auto byte = input[in++];
+            length += byte;
+            if (byte != 255) {
+                return length;
+            }
+        }
+        return SIZE_MAX;
+    };
+
+    size_t in = 0;
+    size_t out = 0;
+    auto ended = false;
+    while (in < input.size()) {
+        auto token = input[in++];
+
+        auto literalLength = readLength(in, token >> 4);
+        if (literalLength > input.size() - in || literalLength > output.size() - out) {
+            return false;
+        }
+        if (literalLength != 0) {
+            std::memcpy(output.data() + out, input.data() + in, literalLength);
+        }
+        in += literalLength;
+        out += literalLength;
+
+        // Only the last sequence ends without a match, a stream cut right
+        // after a match is missing it.
+        if (in == input.size()) {
+            ended = true;
+            break;
+        }
+        if (input.size() - in < 2) {
+            return false;
+        }
+        auto offset = size_t(input[in]) | (size_t(input[in + 1]) << 8);
+        in += 2;
+
+        auto matchLength = readLength(in, token & 15);
+        if (matchLength == SIZE_MAX || offset == 0 || offset > out) {
+            return false;
+        }
+        matchLength += kMinMatch;
+        if (matchLength > output.size() - out) {
+            return false;
+        }
+
+        // Overlapping matches repeat the bytes just written, one at a time.
+        auto source = output.data() + out - offset;
+        auto target = output.data() + out;
+        if (offset >= matchLength) {
+            std::memcpy(target, source, matchLength);
+        } else {
+            for (size_t k = 0; k < matchLength; ++k) {
+                target[k] = source[k];
+            }
+        }
+        out += matchLength;
+    }
+    return ended && out == output.size();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <span>
+#include <vector>
+
+// Byte oriented LZ77 in the spirit of LZ4: a sequence is a token with the
+// literal and match lengths, the literals and a 16-bit back reference.
+// Compression is a single greedy pass with a hash table of recent positions,
+// decompression is a copy loop. The sizes are not stored, the caller keeps
+// the uncompressed size next to the payload.
+
+[[nodiscard]]
+auto compress(std::span<const u8> input) -> std::vector<u8>;
+
+// Returns false unless the input decodes to exactly output.size() bytes.
+[[nodiscard]]
+auto decompress(std::span<const u8> input, std::span<u8> output) -> bool;
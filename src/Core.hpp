@@ -78,11 +78,17 @@ struct ObjectConstants {
 struct HDR_Settings {
     float1 exposure;
     float1 gamma;
+    int1   edgeAwareUpsampling;
+    float1 renderScaleX;
+    float1 renderScaleY;
 };
 
 struct Material {
-    float4 color;
-    float3 ambient;
+    float4 albedo;
+    float  roughness;
+    float  metallic;
+    i32    textureIndex;
+    i32    textureLevels;
 };
 
 struct Light {
@@ -91,4 +97,5 @@ struct Light {
 
     float brightness;
     float intensity;
+    float radius;
 };
\ No newline at end of file
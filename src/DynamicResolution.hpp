@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Core.hpp"
+
+struct DynamicResolution {
+public:
+    f32 minScale = 0.25f;
+    f32 maxScale = 1.0f;
+
+    // Fraction of the budget the smoothed frame time has to leave before the
+    // scale changes, kept asymmetric so the controller does not oscillate.
+    f32 upperThreshold = 1.05f;
+    f32 lowerThreshold = 0.85f;
+
+    // Frames to wait after a change, GPU timings arrive a few frames late.
+    i32 cooldownFrames = 8;
+
+public:
+    auto update(f32 scale, f64 gpuFrameTime, f64 targetFrameTime) -> f32 {
+        if (gpuFrameTime <= 0.0) {
+            return scale;
+        }
+
+        smoothedFrameTime = smoothedFrameTime > 0.0
+            ? glm::mix(smoothedFrameTime, gpuFrameTime, 0.1)
+            : gpuFrameTime;
+
+        if (cooldown > 0) {
+            cooldown -= 1;
+            return scale;
+        }
+
+        auto ratio = smoothedFrameTime / targetFrameTime;
+        if (ratio < f64(lowerThreshold) && scale >= maxScale) {
+            return scale;
+        }
+        if (ratio <= f64(upperThreshold) && ratio >= f64(lowerThreshold)) {
+            return scale;
+        }
+
+        // Ray cost scales with the pixel count, i.e. with the square of the scale.
+        auto step = glm::clamp(f32(glm::sqrt(1.0 / ratio)), 0.9f, 1.1f);
+        auto next = glm::clamp(glm::round(scale * step * 64.0f) / 64.0f, minScale, maxScale);
+        if (next != scale) {
+            cooldown = cooldownFrames;
+            smoothedFrameTime = 0.0;
+        }
+        return next;
+    }
+
+    [[nodiscard]]
+    auto getSmoothedFrameTime() const -> f64 {
+        return smoothedFrameTime;
+    }
+
+private:
+    f64 smoothedFrameTime = 0.0;
+    i32 cooldown = 0;
+};
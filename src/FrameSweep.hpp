@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Core.hpp"
+#include "GpuTimer.hpp"
+
+// Walks through a number of steps, each rendered for warmup frames and then
+// sample frames whose raytrace GPU time is summed. The sweeps built on it
+// decide what a step changes and what they keep of it.
+struct FrameSweep {
+public:
+    i32 warmupFrames = 8;
+    i32 sampleFrames = 32;
+
+public:
+    void start(size_t count) {
+        stepCount = count;
+        step = 0;
+        frameCount = 0;
+        totalTime = 0.0;
+    }
+
+    [[nodiscard]]
+    auto isRunning() const -> bool {
+        return step < stepCount;
+    }
+
+    [[nodiscard]]
+    auto getStep() const -> size_t {
+        return step;
+    }
+
+    // Called once per frame, returns true when the frame was sampled.
+    auto advance(const GpuTimer& timer) -> bool {
+        // GPU timings arrive a few frames late, the warmup frames cover that.
+        frameCount += 1;
+        if (frameCount <= warmupFrames) {
+            return false;
+        }
+        totalTime += timer.getTime("Raytrace");
+        return true;
+    }
+
+    [[nodiscard]]
+    auto isStepDone() const -> bool {
+        return frameCount >= warmupFrames + sampleFrames;
+    }
+
+    // Milliseconds summed over the sampled frames of the current step.
+    [[nodiscard]]
+    auto getTotalTime() const -> f64 {
+        return totalTime;
+    }
+
+    [[nodiscard]]
+    auto getAverageTime() const -> f64 {
+        return totalTime / f64(sampleFrames);
+    }
+
+    // Returns false once every step is done.
+    auto nextStep() -> bool {
+        step += 1;
+        frameCount = 0;
+        totalTime = 0.0;
+        return isRunning();
+    }
+
+private:
+    size_t stepCount = 0;
+    size_t step = 0;
+    i32 frameCount = 0;
+    f64 totalTime = 0.0;
+};
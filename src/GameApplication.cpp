@@ -3,6 +3,21 @@
 #include "Camera.hpp"
 #include "Options.hpp"
 #include "DrawList.hpp"
+#include "DynamicResolution.hpp"
+#include "GpuTimer.hpp"
+#include "LightTree.hpp"
+#include "MaterialTable.hpp"
+#include "RaytraceScene.hpp"
+#include "TextureArray.hpp"
+#include "Brickmap.hpp"
+#include "ChunkStreamer.hpp"
+#include "RegionStorage.hpp"
+#include "StagingRing.hpp"
+#include "TerrainGenerator.hpp"
+#include "VoxelGrid.hpp"
+#include "VoxelSweep.hpp"
+#include "TileSweep.hpp"
+#include "VoxelBenchmark.hpp"
 #include "PlayerInput.hpp"
 #include "MouseHandler.hpp"
 #include "ImGuiRenderer.hpp"
@@ -14,11 +29,76 @@
 
 #include "stb_image.h"
 
-struct RaytraceVertex {
-    float3 position = {};
-    float3 normal   = {};
-    float3 color    = {};
-    float2 texcoord = {};
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+struct RaytraceConstants {
+    glm::vec3 cameraPosition;
+    float time;
+    int accumulateFrame;
+    int renderWidth;
+    int renderHeight;
+    int interleave;
+    int frameIndex;
+    int tileWidth;
+    int tileHeight;
+    int mortonOrder;
+    int maxBounces;
+    int rouletteDepth;
+    int nextEventEstimation;
+    int lightTree;
+    int voxelWorld;
+    float voxelLodDistance;
+    int materialCount;
+    int lightCount;
+};
+
+// Mirrors PathState in wavefront.glsl, only its size is used on the CPU.
+struct WavefrontPathState {
+    float3 origin;
+    float1 hitDistance;
+    float3 direction;
+    uint1  rng;
+    float3 throughput;
+    int1   pixel;
+    float3 radiance;
+    int1   bounce;
+    float3 hitNormal;
+    float1 bsdfPdf;
+    float3 sunConnection;
+    float1 lightDistance;
+    float3 lightConnection;
+    uint1  hitMaterial;
+    float3 lightDirection;
+    float1 hitTexelDensity;
+    float2 hitTexCoord;
+    float1 coneWidth;
+    float1 coneSpread;
+};
+static_assert(sizeof(WavefrontPathState) == 144);
+
+// Sets every block whose center lies inside the sphere.
+static void fillSphere(World& world, const glm::vec3& center, f32 radius, BlockId block) {
+    auto min = glm::ivec3(glm::floor(center - radius));
+    auto max = glm::ivec3(glm::ceil(center + radius));
+    for (i32 y = min.y; y <= max.y; ++y) {
+        for (i32 z = min.z; z <= max.z; ++z) {
+            for (i32 x = min.x; x <= max.x; ++x) {
+                if (glm::distance(glm::vec3(x, y, z) + 0.5f, center) <= radius) {
+                    world.setBlock(BlockPosition{x, y, z}, block);
+                }
+            }
+        }
+    }
+}
+
+// Blocks above this are not uploaded for the voxel traversal.
+static constexpr i32 kVoxelHeight = 64;
+
+struct WavefrontQueueHeader {
+    u32 count;
+    vk::DispatchIndirectCommand dispatch;
 };
 
 GameApplication::GameApplication() {
@@ -35,12 +115,23 @@ GameApplication::GameApplication() {
     swapchain->displaySyncEnabled = true;
     swapchain->updateDrawables();
 
+    // The CPU runs at most one frame ahead per swapchain image, per-frame
+    // resources are kept that many times.
+    auto framesInFlight = u32(swapchain->drawables.size());
+
     commandQueue = device->makeCommandQueue();
 
     options = Arc<Options>::alloc();
     playerInput = Arc<PlayerInput>::alloc(options);
     mouseHandler = Arc<MouseHandler>::alloc(window);
     imguiRenderer = Arc<ImGuiRenderer>::alloc(device, window);
+    gpuTimer = Arc<GpuTimer>::alloc(device, framesInFlight);
+    dynamicResolution = Arc<DynamicResolution>::alloc();
+    tileSweep = Arc<TileSweep>::alloc();
+    voxelSweep = Arc<VoxelSweep>::alloc();
+    stagingRing = Arc<StagingRing>::alloc(device, 4 * 1024 * 1024, framesInFlight);
+    threadPool = Arc<ThreadPool>::alloc();
+    terrainGenerator = Arc<TerrainGenerator>::alloc(42);
 
     sampler = device->makeSampler(vk::SamplerCreateInfo{
         .magFilter = vk::Filter::eNearest,
@@ -51,6 +142,15 @@ GameApplication::GameApplication() {
         .addressModeW = vk::SamplerAddressMode::eRepeat
     });
 
+    presentSampler = device->makeSampler(vk::SamplerCreateInfo{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eNearest,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge
+    });
+
     auto rawTextureData = Assets::readFile("textures/Mossy_Cobblestone.png");
 
     stbi_set_flip_vertically_on_load(true);
@@ -59,23 +159,38 @@ GameApplication::GameApplication() {
     i32 height = 0;
     auto rawPixels = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(rawTextureData.data()), i32(rawTextureData.size()), &width, &height, nullptr, 4);
 
-    texture = device->makeTexture(vfx::TextureDescription{
-        .format = vk::Format::eR8G8B8A8Unorm,
-        .width = u32(width),
-        .height = u32(height),
-        .usage = vk::ImageUsageFlagBits::eColorAttachment
-            | vk::ImageUsageFlagBits::eInputAttachment
-            | vk::ImageUsageFlagBits::eSampled
-            | vk::ImageUsageFlagBits::eTransferDst
-    });
-
-    texture->update(rawPixels, width * height * 4);
+    auto cobblestonePixels = std::vector<u32>(reinterpret_cast<u32*>(rawPixels), reinterpret_cast<u32*>(rawPixels) + width * height);
 
     stbi_image_free(rawPixels);
 
+    auto makeSampledTexture = [&](u32 width, u32 height, const std::vector<u32>& pixels) {
+        auto result = device->makeTexture(vfx::TextureDescription{
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .width = width,
+            .height = height,
+            .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+        });
+        result->update(pixels.data(), pixels.size() * sizeof(u32));
+        return result;
+    };
+
+    auto checkerPixels = std::vector<u32>(64 * 64);
+    for (u32 y = 0; y < 64; ++y) {
+        for (u32 x = 0; x < 64; ++x) {
+            checkerPixels[y * 64 + x] = ((x / 8 + y / 8) & 1) != 0 ? 0xFFFFFFFF : 0xFF9F9F9F;
+        }
+    }
+
+    textureArray = Arc<TextureArray>::alloc(device, makeSampledTexture(1, 1, std::vector<u32>{0xFFFFFFFF}));
+    auto cobblestoneTextureIndex = textureArray->addMipmapped(u32(width), u32(height), cobblestonePixels);
+    auto checkerTextureIndex = textureArray->addMipmapped(64, 64, checkerPixels);
+
     createDefaultPipelineObjects();
     createPresentPipelineObjects();
     createRaytracePipelineObjects();
+    createReconstructPipelineObjects();
+    createDenoisePipelineObjects();
+    createWavefrontPipelineObjects();
 
     updateTextureAttachments();
 
@@ -101,51 +216,90 @@ GameApplication::GameApplication() {
 
     auto vertices = std::vector{
         // south
-        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(0, 0, +1), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(0, 0, +1), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(0, 0, +1), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(0, 0, +1), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(0, 0, +1), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(0, 0, +1), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(0, 0, +1), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(0, 0, +1), glm::vec2(1, 0)},
 
         // north
-        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(0, 0, -1), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(0, 0, -1), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(0, 0, -1), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(0, 0, -1), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(0, 0, -1), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(0, 0, -1), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(0, 0, -1), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(0, 0, -1), glm::vec2(1, 0)},
 
         // east
-        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(+1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(+1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(+1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(+1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(+1, 0, 0), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(+1, 0, 0), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(+1, 0, 0), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(+1, 0, 0), glm::vec2(1, 0)},
 
         // west
-        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(-1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(-1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(-1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(-1, 0, 0), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(-1, 0, 0), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(-1, 0, 0), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(-1, 0, 0), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(-1, 0, 0), glm::vec2(1, 0)},
 
         // up
-        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(0, +1, 0), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(0, +1, 0), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(0, +1, 0), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(0, +1, 0), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+        RaytraceVertex{glm::vec3(-1, +1, -1), glm::vec3(0, +1, 0), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(-1, +1, +1), glm::vec3(0, +1, 0), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(+1, +1, +1), glm::vec3(0, +1, 0), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(+1, +1, -1), glm::vec3(0, +1, 0), glm::vec2(1, 0)},
 
         // down
-        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(0, -1, 0), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
-        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(0, -1, 0), glm::vec3(1, 1, 1), glm::vec2(0, 1)},
-        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(0, -1, 0), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
-        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(0, -1, 0), glm::vec3(1, 1, 1), glm::vec2(1, 0)}
+        RaytraceVertex{glm::vec3(-1, -1, +1), glm::vec3(0, -1, 0), glm::vec2(0, 0)},
+        RaytraceVertex{glm::vec3(-1, -1, -1), glm::vec3(0, -1, 0), glm::vec2(0, 1)},
+        RaytraceVertex{glm::vec3(+1, -1, -1), glm::vec3(0, -1, 0), glm::vec2(1, 1)},
+        RaytraceVertex{glm::vec3(+1, -1, +1), glm::vec3(0, -1, 0), glm::vec2(1, 0)}
+    };
+
+    // Two triangles per face, in the same order as the faces above.
+    auto triangleMaterials = std::vector<u16>{
+        0, 0,
+        0, 0,
+        1, 1,
+        2, 2,
+        0, 0,
+        1, 1
     };
+
+    auto materials = std::vector{
+        Material{.albedo = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), .roughness = 0.9f, .metallic = 0.0f, .textureIndex = cobblestoneTextureIndex, .textureLevels = textureArray->getLevelCount(cobblestoneTextureIndex)},
+        Material{.albedo = glm::vec4(0.8f, 0.2f, 0.2f, 1.0f), .roughness = 0.5f, .metallic = 0.0f, .textureIndex = checkerTextureIndex, .textureLevels = textureArray->getLevelCount(checkerTextureIndex)},
+        Material{.albedo = glm::vec4(1.0f, 0.8f, 0.4f, 1.0f), .roughness = 0.3f, .metallic = 1.0f, .textureIndex = -1, .textureLevels = 0}
+    };
+    auto materialTable = MaterialTable(materials);
+    materialCount = i32(materials.size());
+
+    raytraceScene = Arc<RaytraceScene>::alloc(std::move(vertices), std::move(indices), std::move(triangleMaterials));
+
     raytraceIndexBuffer = device->makeBuffer(
         vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
-        sizeof(i32) * indices.size(),
-        indices.data(),
+        sizeof(i32) * raytraceScene->getIndices().size(),
+        raytraceScene->getIndices().data(),
         VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
     );
-    raytraceVertexBuffer = device->makeBuffer(
-        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
-        sizeof(RaytraceVertex) * vertices.size(),
-        vertices.data(),
+    raytraceTriangleBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(RaytraceTriangle) * raytraceScene->getTriangles().size(),
+        raytraceScene->getTriangles().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    raytraceAttributeBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(PackedVertexAttributes) * raytraceScene->getPackedAttributes().size(),
+        raytraceScene->getPackedAttributes().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    triangleMaterialBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(u16) * raytraceScene->getMaterials().size(),
+        raytraceScene->getMaterials().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    materialBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        materialTable.getData().size(),
+        materialTable.getData().data(),
         VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
     );
     sceneConstantsBuffer = device->makeBuffer(
@@ -155,9 +309,41 @@ GameApplication::GameApplication() {
     );
     defaultResourceGroup->setBuffer(sceneConstantsBuffer, 0, 0);
     raytraceResourceGroup->setStorageBuffer(raytraceIndexBuffer, 0, 3);
-    raytraceResourceGroup->setStorageBuffer(raytraceVertexBuffer, 0, 4);
+    raytraceResourceGroup->setStorageBuffer(raytraceTriangleBuffer, 0, 4);
     raytraceResourceGroup->setSampler(sampler, 5);
-    raytraceResourceGroup->setTexture(texture, 6);
+    textureArray->bind(raytraceResourceGroup, 6);
+    raytraceResourceGroup->setStorageBuffer(materialBuffer, materialTable.getOffset(MaterialTable::Stream::eAlbedo), 16);
+    raytraceResourceGroup->setStorageBuffer(materialBuffer, materialTable.getOffset(MaterialTable::Stream::eTexture), 17);
+    raytraceResourceGroup->setStorageBuffer(triangleMaterialBuffer, 0, 18);
+    raytraceResourceGroup->setStorageBuffer(raytraceAttributeBuffer, 0, 19);
+    wavefrontExtendResourceGroup->setStorageBuffer(raytraceIndexBuffer, 0, 3);
+    wavefrontExtendResourceGroup->setStorageBuffer(raytraceTriangleBuffer, 0, 4);
+    wavefrontExtendResourceGroup->setStorageBuffer(triangleMaterialBuffer, 0, 18);
+    wavefrontExtendResourceGroup->setStorageBuffer(raytraceAttributeBuffer, 0, 19);
+    wavefrontShadeResourceGroup->setSampler(sampler, 5);
+    textureArray->bind(wavefrontShadeResourceGroup, 6);
+    wavefrontShadeResourceGroup->setStorageBuffer(materialBuffer, materialTable.getOffset(MaterialTable::Stream::eAlbedo), 16);
+    wavefrontShadeResourceGroup->setStorageBuffer(materialBuffer, materialTable.getOffset(MaterialTable::Stream::eTexture), 17);
+    wavefrontConnectResourceGroup->setStorageBuffer(raytraceTriangleBuffer, 0, 4);
+
+    world = Arc<World>::alloc();
+    regionStorage = Arc<RegionStorage>::alloc(options->worldDirectory);
+    chunkStreamer = Arc<ChunkStreamer>::alloc(world, threadPool, terrainGenerator, regionStorage);
+    generateTerrain(ChunkPosition{-4, -4}, ChunkPosition{3, 3});
+
+    auto voxelGrid = VoxelGrid(*world, ChunkPosition{-4, -4}, ChunkPosition{3, 3}, kVoxelHeight);
+    voxelGridBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(u32) * voxelGrid.getData().size(),
+        voxelGrid.getData().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    raytraceResourceGroup->setStorageBuffer(voxelGridBuffer, 0, 20);
+    wavefrontExtendResourceGroup->setStorageBuffer(voxelGridBuffer, 0, 20);
+    wavefrontConnectResourceGroup->setStorageBuffer(voxelGridBuffer, 0, 20);
+
+    updateBrickmap();
+    updateLights();
 }
 
 GameApplication::~GameApplication() {
@@ -196,8 +382,18 @@ void GameApplication::update(f32 dt) {
             auto orientation = glm::mat3x3(glm::quat(glm::radians(cameraRotation)));
             auto velocity = glm::normalize(orientation * glm::vec3(direction)) * 10.0f;
 
-            cameraPosition += velocity * dt;
-            accumulateFrame = 0;
+            // The camera stops just in front of the scene instead of flying into it.
+            auto blocked = false;
+            if (options->voxelMode != 0) {
+                auto next = glm::floor(cameraPosition + velocity * dt + glm::normalize(velocity) * 0.1f);
+                blocked = world->getBlock(BlockPosition{i32(next.x), i32(next.y), i32(next.z)}) != 0;
+            } else {
+                blocked = raytraceScene->isOccluded(cameraPosition, glm::normalize(velocity), glm::length(velocity * dt) + 0.1f);
+            }
+            if (!blocked) {
+                cameraPosition += velocity * dt;
+                accumulateFrame = 0;
+            }
         }
 
         f64 d4 = 2.0 * 0.5 * 0.6 + 0.2;
@@ -214,19 +410,187 @@ void GameApplication::update(f32 dt) {
         }
 
     }
+
+    if (options->voxelMode == 2 && options->streamChunks) {
+        updateStreaming();
+    }
 }
 
 void GameApplication::render() {
+    if (options->dynamicResolution) {
+        auto scale = dynamicResolution->update(options->renderScale, gpuTimer->getFrameTime(), options->targetFrameTime);
+        if (scale != options->renderScale) {
+            options->renderScale = scale;
+            accumulateFrame = 0;
+        }
+    }
+
+    if (tileSweep->isRunning()) {
+        auto shape = tileSweep->update(*gpuTimer, TileShape{options->tileWidth, options->tileHeight, options->mortonOrder});
+        options->tileWidth = shape.width;
+        options->tileHeight = shape.height;
+        options->mortonOrder = shape.mortonOrder;
+
+        if (!tileSweep->isRunning()) {
+            auto properties = device->gpu.getProperties(device->interface);
+            spdlog::info("Fastest raytrace tile on {}: {}x{}{}", properties.deviceName.data(), shape.width, shape.height, shape.mortonOrder ? " (morton)" : "");
+        }
+    }
+
+    if (voxelSweep->isRunning()) {
+        // Camera rays traced per frame, interleaved modes skip the rest.
+        auto renderSize = getRenderSize();
+        auto rays = u64(renderSize.width) * u64(renderSize.height) / u64(options->interleave);
+
+        auto viewDistance = voxelSweep->update(*gpuTimer, options->viewDistance, rays);
+        if (viewDistance != options->viewDistance) {
+            options->viewDistance = viewDistance;
+            updateBrickmap();
+            accumulateFrame = 0;
+        }
+
+        if (!voxelSweep->isRunning()) {
+            for (auto& result : voxelSweep->getResults()) {
+                spdlog::info("Brickmap at {} chunks: {:.3f} ms, {:.1f} Mrays/s, {:.1f} MB (dense grid {:.1f} MB)", result.viewDistance, result.milliseconds, result.raysPerSecond / 1e6, f64(result.brickmapBytes) / 1e6, f64(result.gridBytes) / 1e6);
+            }
+        }
+    }
+
     imguiRenderer->beginFrame();
     ImGui::SetNextWindowPos(ImVec2(0, 0));
     ImGui::SetNextWindowSize(ImVec2(0, 0));
     ImGui::Begin("Debug info");
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Separator();
+    ImGui::Checkbox("Dynamic resolution", &options->dynamicResolution);
+    if (options->dynamicResolution) {
+        ImGui::SliderFloat("Target frame time", &options->targetFrameTime, 4.0f, 33.3f, "%.1f ms");
+        ImGui::Text("Render scale: %.2f (%.3f ms smoothed)", options->renderScale, dynamicResolution->getSmoothedFrameTime());
+    } else if (ImGui::SliderFloat("Render scale", &options->renderScale, 0.25f, 1.0f)) {
+        accumulateFrame = 0;
+    }
+    if (ImGui::SliderInt("Max bounces", &options->maxBounces, 1, 16)) {
+        accumulateFrame = 0;
+    }
+    if (ImGui::SliderInt("Roulette depth", &options->rouletteDepth, 0, 16)) {
+        accumulateFrame = 0;
+    }
+    if (ImGui::Checkbox("Wavefront", &options->wavefront)) {
+        accumulateFrame = 0;
+    }
+    if (ImGui::Checkbox("Light sampling", &options->nextEventEstimation)) {
+        accumulateFrame = 0;
+    }
+    if (options->nextEventEstimation && ImGui::Checkbox("Light tree", &options->lightTree)) {
+        accumulateFrame = 0;
+    }
+    auto previousVoxelMode = options->voxelMode;
+    if (ImGui::Combo("Scene", &options->voxelMode, "Triangles\0Voxel grid\0Brickmap\0")) {
+        if ((previousVoxelMode == 0) != (options->voxelMode == 0)) {
+            cameraPosition = options->voxelMode != 0 ? glm::vec3(0, 60, 0) : glm::vec3(0, 0, -8);
+        }
+        accumulateFrame = 0;
+    }
+    if (options->voxelMode == 2) {
+        ImGui::SliderInt("View distance", &options->viewDistance, 2, 64);
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            updateBrickmap();
+            accumulateFrame = 0;
+        }
+        ImGui::SliderFloat("LOD distance", &options->voxelLodDistance, 0.0f, 1024.0f, "%.0f blocks");
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            updateBrickmap();
+            accumulateFrame = 0;
+        }
+        if (voxelSweep->isRunning()) {
+            ImGui::Text("Running brickmap sweep...");
+        } else {
+            if (ImGui::Button("Run brickmap sweep")) {
+                voxelSweep->start(options->viewDistance);
+            }
+            for (auto& result : voxelSweep->getResults()) {
+                ImGui::Text("%d chunks: %.3f ms, %.1f Mrays/s, %.1f MB (dense %.1f MB)", result.viewDistance, result.milliseconds, result.raysPerSecond / 1e6, f64(result.brickmapBytes) / 1e6, f64(result.gridBytes) / 1e6);
+            }
+        }
+
+        ImGui::Checkbox("Stream chunks", &options->streamChunks);
+        if (options->streamChunks) {
+            ImGui::SliderInt("Memory budget", &options->chunkMemoryBudget, 16, 4096, "%d MB");
+            auto& stats = chunkStreamer->getStats();
+            ImGui::Text("%zu chunks, %.1f MB, %zu pending, radius %d", stats.loadedChunks, f64(stats.memoryUsage) / 1e6, stats.pendingRequests, stats.loadRadius);
+            ImGui::Text("generated %llu, cancelled %llu, evicted %llu", static_cast<unsigned long long>(stats.generated), static_cast<unsigned long long>(stats.cancelled), static_cast<unsigned long long>(stats.evicted));
+            ImGui::Text("loaded %llu, saved %llu", static_cast<unsigned long long>(stats.loadedFromStorage), static_cast<unsigned long long>(stats.saved));
+        }
+
+        // Edits a few blocks in front of the camera, only the touched
+        // chunks are uploaded on the next frame.
+        auto target = cameraPosition + glm::mat3x3(glm::quat(glm::radians(cameraRotation))) * glm::vec3(0, 0, 8);
+        if (ImGui::Button("Carve sphere")) {
+            fillSphere(*world, target, 4.0f, 0);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Place sphere")) {
+            fillSphere(*world, target, 4.0f, 3);
+        }
+        ImGui::Text("Last upload: %llu bytes in %zu regions", static_cast<unsigned long long>(stagingRing->getUploadedBytes()), stagingRing->getRegionCount());
+    }
+    if (ImGui::Checkbox("10k lights benchmark", &options->manyLights)) {
+        device->waitIdle();
+        updateLights();
+        accumulateFrame = 0;
+    }
+    ImGui::Checkbox("Edge-aware upsampling", &options->edgeAwareUpsampling);
+    auto interleaveMode = options->interleave == 4 ? 2 : options->interleave == 2 ? 1 : 0;
+    if (ImGui::Combo("Interleave", &interleaveMode, "Off\0Checkerboard\0Quarter\0")) {
+        options->interleave = std::array{1, 2, 4}[interleaveMode];
+        accumulateFrame = 0;
+    }
+    ImGui::Checkbox("Denoise", &options->denoise);
+    if (options->denoise) {
+        ImGui::SliderInt("Iterations", &options->denoiseIterations, 2, 6);
+        ImGui::SliderFloat("Color phi", &options->denoiseColorPhi, 0.1f, 16.0f);
+        ImGui::SliderFloat("Normal phi", &options->denoiseNormalPhi, 1.0f, 256.0f);
+        ImGui::SliderFloat("Depth phi", &options->denoiseDepthPhi, 0.01f, 1.0f);
+    }
+    ImGui::Text("Tile: %dx%d%s", options->tileWidth, options->tileHeight, options->mortonOrder ? " (morton)" : "");
+    if (tileSweep->isRunning()) {
+        ImGui::Text("Running tile sweep...");
+    } else {
+        if (ImGui::Button("Run tile sweep")) {
+            tileSweep->start();
+        }
+        for (auto& result : tileSweep->getResults()) {
+            ImGui::Text("%dx%d%s: %.3f ms", result.shape.width, result.shape.height, result.shape.mortonOrder ? " (morton)" : "", result.milliseconds);
+        }
+    }
+    ImGui::Separator();
+    if (ImGui::Button("World access benchmark")) {
+        runWorldAccessBenchmark();
+    }
+    if (ImGui::Button("Section benchmark")) {
+        runSectionBenchmark();
+    }
+    if (ImGui::Button("Meshing benchmark")) {
+        runMeshingBenchmark(*world);
+    }
+    if (ImGui::Button("Terrain benchmark")) {
+        runTerrainBenchmark();
+    }
+    if (ImGui::Button("Region benchmark")) {
+        runRegionBenchmark();
+    }
+    ImGui::Separator();
+    for (auto& result : gpuTimer->getResults()) {
+        ImGui::Text("%s: %.3f ms", result.name.c_str(), result.milliseconds);
+    }
+    ImGui::Text("GPU total: %.3f ms", gpuTimer->getFrameTime());
     ImGui::End();
     imguiRenderer->endFrame();
 
     auto cmd = commandQueue->makeCommandBuffer();
     cmd->begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    gpuTimer->beginFrame(cmd);
+    uploadBrickmapChanges(cmd);
 
 //    // todo: move to a better place
 //    cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
@@ -264,8 +628,11 @@ void GameApplication::render() {
 //    });
 //    cmd->flushBarriers();
 
-    auto imageWidth = colorAttachmentTexture->size.width;
-    auto imageHeight = colorAttachmentTexture->size.height;
+    // Targets are allocated for the full drawable and only the render-size
+    // sub-rect is traced, so changing the scale never reallocates them.
+    auto renderSize = getRenderSize();
+    auto imageWidth = renderSize.width;
+    auto imageHeight = renderSize.height;
 
     auto cameraAspect = f32(imageWidth) / f32(imageHeight);
     auto projectionMatrix = Camera::getInfinityProjectionMatrix(60.0f, cameraAspect, 0.01f);
@@ -282,81 +649,108 @@ void GameApplication::render() {
     };
     auto resolution = glm::vec2(f32(imageWidth), f32(imageHeight));
 
+    auto storageAttachments = std::array{
+        colorAttachmentTexture,
+        accumulateAttachmentTexture,
+        normalDepthAttachmentTexture,
+        albedoAttachmentTexture,
+        denoiseAttachmentTextures[0],
+        denoiseAttachmentTextures[1]
+    };
+
     // todo: move to a better place
-    cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
-        .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-        .srcAccessMask = vk::AccessFlagBits2{},
-        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-        .oldLayout = vk::ImageLayout::eUndefined,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = colorAttachmentTexture->image,
-        .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .levelCount = 1,
-            .layerCount = 1
-        }
-    });
-    // todo: move to a better place
-    cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
-        .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-        .srcAccessMask = vk::AccessFlagBits2{},
-        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-        .oldLayout = vk::ImageLayout::eUndefined,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = accumulateAttachmentTexture->image,
-        .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .levelCount = 1,
-            .layerCount = 1
-        }
-    });
+    for (auto& attachment : storageAttachments) {
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
+            .srcAccessMask = vk::AccessFlagBits2{},
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachment->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+    }
     cmd->flushBarriers();
     accumulateFrame += 1;
+    frameIndex += 1;
 
-    struct ComputeData {
-        glm::vec3 cameraPosition;
-        float time;
-        int accumulateFrame;
-    };
-    auto computeData = ComputeData{
+    auto computeData = RaytraceConstants{
         .cameraPosition = cameraPosition,
         .time = float(glfwGetTime()),
-        .accumulateFrame = accumulateFrame
+        .accumulateFrame = accumulateFrame,
+        .renderWidth = i32(imageWidth),
+        .renderHeight = i32(imageHeight),
+        .interleave = options->interleave,
+        .frameIndex = frameIndex,
+        .tileWidth = options->tileWidth,
+        .tileHeight = options->tileHeight,
+        .mortonOrder = options->mortonOrder ? 1 : 0,
+        .maxBounces = options->maxBounces,
+        .rouletteDepth = options->rouletteDepth,
+        .nextEventEstimation = options->nextEventEstimation ? 1 : 0,
+        .lightTree = options->lightTree ? 1 : 0,
+        .voxelWorld = options->voxelMode,
+        .voxelLodDistance = options->voxelLodDistance,
+        .materialCount = materialCount,
+        .lightCount = i32(lights.size())
     };
 
-    cmd->setComputePipelineState(raytracePipelineState);
-    cmd->bindResourceGroup(raytraceResourceGroup, 0);
-    cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(ComputeData), &computeData);
+    // Interleaved modes only launch threads for the pixels traced this frame.
+    auto dispatchWidth = options->interleave == 1 ? imageWidth : (imageWidth + 1) / 2;
+    auto dispatchHeight = options->interleave == 4 ? (imageHeight + 1) / 2 : imageHeight;
+
+    gpuTimer->begin(cmd, "Raytrace");
+    if (options->wavefront) {
+        encodeWavefrontPasses(cmd, computeData, vk::Extent2D{dispatchWidth, dispatchHeight});
+    } else {
+        cmd->setComputePipelineState(raytracePipelineState);
+        cmd->bindResourceGroup(raytraceResourceGroup, 0);
+        cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RaytraceConstants), &computeData);
+
+        cmd->dispatch(
+            (dispatchWidth + u32(options->tileWidth) - 1) / u32(options->tileWidth),
+            (dispatchHeight + u32(options->tileHeight) - 1) / u32(options->tileHeight),
+            1
+        );
+    }
+    gpuTimer->end(cmd);
 
-    cmd->dispatch(
-        (colorAttachmentTexture->size.width / 10) + 1,
-        (colorAttachmentTexture->size.height / 10) + 1,
-        1
-    );
+    if (options->interleave > 1) {
+        encodeReconstructPass(cmd, viewProjectionMatrix);
+    } else {
+        historyValid = false;
+    }
+
+    if (options->denoise) {
+        encodeDenoisePasses(cmd);
+    }
 
     // todo: move to a better place
-    cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
-        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-        .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
-        .dstAccessMask = vk::AccessFlagBits2::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eReadOnlyOptimal,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = colorAttachmentTexture->image,
-        .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .levelCount = 1,
-            .layerCount = 1
-        }
-    });
+    for (auto& attachment : {colorAttachmentTexture, normalDepthAttachmentTexture}) {
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderRead,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eReadOnlyOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachment->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+    }
     cmd->flushBarriers();
 
     auto rd_ptr = static_cast<glm::vec4*>(rayDirections->map());
@@ -564,10 +958,15 @@ void GameApplication::render() {
     HDR_Settings hdr_settings{};
     hdr_settings.exposure = options->exposure;
     hdr_settings.gamma    = options->gamma;
+    hdr_settings.edgeAwareUpsampling = options->edgeAwareUpsampling ? 1 : 0;
+    hdr_settings.renderScaleX = f32(imageWidth) / f32(colorAttachmentTexture->size.width);
+    hdr_settings.renderScaleY = f32(imageHeight) / f32(colorAttachmentTexture->size.height);
 
+    gpuTimer->begin(cmd, "Blit");
     cmd->pushConstants(vk::ShaderStageFlagBits::eFragment, 0, sizeof(HDR_Settings), &hdr_settings);
     cmd->draw(6, 1, 0, 0);
     cmd->endRendering();
+    gpuTimer->end(cmd);
 
     auto gui_rendering_info = vfx::RenderingInfo{};
     gui_rendering_info.renderArea = vk::Rect2D{.extent = drawable->texture->size};
@@ -606,16 +1005,519 @@ void GameApplication::render() {
     cmd->present(drawable);
 }
 
+void GameApplication::encodeWavefrontPasses(vfx::CommandBuffer* cmd, const RaytraceConstants& constants, vk::Extent2D dispatchSize) {
+    // Queue headers are reset and read as indirect arguments between stages,
+    // so every stage boundary waits on all compute and transfer writes.
+    auto barrier = [&] {
+        auto memoryBarrier = vk::MemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eTransferWrite
+        };
+        cmd->handle->pipelineBarrier2(vk::DependencyInfo{
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier
+        }, device->interface);
+    };
+
+    auto reset = [&](const Arc<vfx::Buffer>& queue) {
+        auto header = WavefrontQueueHeader{
+            .count = 0,
+            .dispatch = vk::DispatchIndirectCommand{0, 1, 1}
+        };
+        cmd->handle->updateBuffer(queue->handle, 0, sizeof(WavefrontQueueHeader), &header, device->interface);
+    };
+
+    auto dispatch = [&](const Arc<vfx::ComputePipelineState>& pipelineState, const Arc<vfx::ResourceGroup>& resourceGroup, const Arc<vfx::Buffer>& queue) {
+        cmd->setComputePipelineState(pipelineState);
+        cmd->bindResourceGroup(resourceGroup, 0);
+        cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RaytraceConstants), &constants);
+        cmd->handle->dispatchIndirect(queue->handle, offsetof(WavefrontQueueHeader, dispatch), device->interface);
+    };
+
+    reset(wavefrontRayQueue);
+    barrier();
+
+    cmd->setComputePipelineState(wavefrontGeneratePipelineState);
+    cmd->bindResourceGroup(wavefrontGenerateResourceGroup, 0);
+    cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RaytraceConstants), &constants);
+    cmd->dispatch((dispatchSize.width + 7) / 8, (dispatchSize.height + 7) / 8, 1);
+    barrier();
+
+    // Each bounce only launches the paths that are still alive, and shade
+    // refills the ray queue once extend has consumed it.
+    for (i32 bounce = 0; bounce < options->maxBounces; ++bounce) {
+        reset(wavefrontHitQueue);
+        reset(wavefrontConnectQueue);
+        barrier();
+
+        dispatch(wavefrontExtendPipelineState, wavefrontExtendResourceGroup, wavefrontRayQueue);
+        barrier();
+
+        reset(wavefrontRayQueue);
+        barrier();
+
+        dispatch(wavefrontShadePipelineState, wavefrontShadeResourceGroup, wavefrontHitQueue);
+        barrier();
+
+        dispatch(wavefrontConnectPipelineState, wavefrontConnectResourceGroup, wavefrontConnectQueue);
+        barrier();
+    }
+
+    cmd->setComputePipelineState(wavefrontAccumulatePipelineState);
+    cmd->bindResourceGroup(wavefrontAccumulateResourceGroup, 0);
+    cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RaytraceConstants), &constants);
+    cmd->dispatch((dispatchSize.width + 7) / 8, (dispatchSize.height + 7) / 8, 1);
+}
+
+void GameApplication::encodeReconstructPass(vfx::CommandBuffer* cmd, const glm::mat4& viewProjectionMatrix) {
+    struct ReconstructData {
+        glm::mat4 previousViewProjection;
+        glm::vec3 previousCameraPosition;
+        i32 interleave;
+        glm::vec3 cameraPosition;
+        i32 frameIndex;
+        i32 accumulateFrame;
+        i32 renderWidth;
+        i32 renderHeight;
+        i32 historyValid;
+    };
+
+    auto renderSize = getRenderSize();
+    if (historySize != renderSize) {
+        historyValid = false;
+    }
+
+    // todo: move to a better place
+    for (auto& attachment : {colorAttachmentTexture, accumulateAttachmentTexture, normalDepthAttachmentTexture, albedoAttachmentTexture}) {
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachment->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+    }
+
+    // History textures keep their contents across frames, so they are only
+    // transitioned from an undefined layout when the history is discarded.
+    // todo: move to a better place
+    for (auto& attachment : historyAttachmentTextures) {
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = historyValid ? vk::ImageLayout::eGeneral : vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachment->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+    }
+    cmd->flushBarriers();
+
+    auto reconstructData = ReconstructData{
+        .previousViewProjection = previousViewProjectionMatrix,
+        .previousCameraPosition = previousCameraPosition,
+        .interleave = options->interleave,
+        .cameraPosition = cameraPosition,
+        .frameIndex = frameIndex,
+        .accumulateFrame = accumulateFrame,
+        .renderWidth = i32(renderSize.width),
+        .renderHeight = i32(renderSize.height),
+        .historyValid = historyValid ? 1 : 0
+    };
+
+    gpuTimer->begin(cmd, "Reconstruct");
+    cmd->setComputePipelineState(reconstructPipelineState);
+    cmd->bindResourceGroup(reconstructResourceGroup, 0);
+    cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(ReconstructData), &reconstructData);
+    cmd->dispatch(
+        (renderSize.width + 7) / 8,
+        (renderSize.height + 7) / 8,
+        1
+    );
+    gpuTimer->end(cmd);
+
+    historyValid = true;
+    historySize = renderSize;
+    previousCameraPosition = cameraPosition;
+    previousViewProjectionMatrix = viewProjectionMatrix;
+}
+
+void GameApplication::encodeDenoisePasses(vfx::CommandBuffer* cmd) {
+    struct DenoiseData {
+        i32 stepWidth;
+        i32 source;
+        i32 target;
+        f32 colorPhi;
+        f32 normalPhi;
+        f32 depthPhi;
+        i32 renderWidth;
+        i32 renderHeight;
+    };
+
+    auto renderSize = getRenderSize();
+
+    // todo: move to a better place
+    for (auto& attachment : {colorAttachmentTexture, normalDepthAttachmentTexture, albedoAttachmentTexture}) {
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachment->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+    }
+    cmd->flushBarriers();
+
+    cmd->setComputePipelineState(denoisePipelineState);
+    cmd->bindResourceGroup(denoiseResourceGroup, 0);
+
+    // Passes ping-pong between the two denoise targets (1 and 2), starting
+    // from the raytraced image (0) and writing the last pass back into it.
+    auto iterations = std::max(options->denoiseIterations, 2);
+    auto attachments = std::array{colorAttachmentTexture, denoiseAttachmentTextures[0], denoiseAttachmentTextures[1]};
+
+    i32 source = 0;
+    for (i32 i = 0; i < iterations; ++i) {
+        i32 target = i == iterations - 1 ? 0 : (source == 1 ? 2 : 1);
+
+        auto denoiseData = DenoiseData{
+            .stepWidth = 1 << i,
+            .source = source,
+            .target = target,
+            .colorPhi = options->denoiseColorPhi / f32(1 << i),
+            .normalPhi = options->denoiseNormalPhi,
+            .depthPhi = options->denoiseDepthPhi,
+            .renderWidth = i32(renderSize.width),
+            .renderHeight = i32(renderSize.height)
+        };
+
+        gpuTimer->begin(cmd, fmt::format("Denoise {}", i));
+        cmd->pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(DenoiseData), &denoiseData);
+        cmd->dispatch(
+            (renderSize.width + 7) / 8,
+            (renderSize.height + 7) / 8,
+            1
+        );
+        gpuTimer->end(cmd);
+
+        // todo: move to a better place
+        cmd->imageMemoryBarrier(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = attachments[target]->image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1
+            }
+        });
+        cmd->flushBarriers();
+
+        source = target;
+    }
+}
+
+void GameApplication::generateTerrain(const ChunkPosition& min, const ChunkPosition& max) {
+    auto center = BlockPosition{i32(glm::floor(cameraPosition.x)), 0, i32(glm::floor(cameraPosition.z))}.getChunkPosition();
+
+    auto positions = std::vector<ChunkPosition>();
+    for (i32 cz = min.z; cz <= max.z; ++cz) {
+        for (i32 cx = min.x; cx <= max.x; ++cx) {
+            if (world->getChunk(ChunkPosition{cx, cz}) == nullptr) {
+                positions.emplace_back(ChunkPosition{cx, cz});
+            }
+        }
+    }
+    if (positions.empty()) {
+        return;
+    }
+
+    // Nearest chunks are queued first.
+    std::sort(positions.begin(), positions.end(), [&](const ChunkPosition& a, const ChunkPosition& b) {
+        auto da = (a.x - center.x) * (a.x - center.x) + (a.z - center.z) * (a.z - center.z);
+        auto db = (b.x - center.x) * (b.x - center.x) + (b.z - center.z) * (b.z - center.z);
+        return da < db;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    auto futures = std::vector<std::future<std::unique_ptr<Chunk>>>();
+    futures.reserve(positions.size());
+    for (auto& position : positions) {
+        // Saved chunks win over generated ones, the streamer saves every
+        // edited chunk it finds loaded.
+        futures.emplace_back(threadPool->submit([generator = terrainGenerator, storage = regionStorage, position] {
+            if (auto chunk = storage->loadChunk(position)) {
+                return chunk;
+            }
+            return generator->generate(position);
+        }));
+    }
+    for (auto& future : futures) {
+        world->addChunk(future.get());
+    }
+    auto elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+    auto chunksPerSecond = f64(positions.size()) / (elapsed / 1000.0);
+    spdlog::info("Loaded {} chunks in {:.1f} ms ({:.0f} chunks/s, {:.0f} chunks/s per core{})", positions.size(), elapsed, chunksPerSecond, chunksPerSecond / f64(threads), terrainGenerator->isUsingSimd() ? ", AVX2" : "");
+}
+
+void GameApplication::updateBrickmap() {
+    auto center = BlockPosition{i32(glm::floor(cameraPosition.x)), 0, i32(glm::floor(cameraPosition.z))}.getChunkPosition();
+    auto min = ChunkPosition{center.x - options->viewDistance, center.z - options->viewDistance};
+    auto max = ChunkPosition{center.x + options->viewDistance - 1, center.z + options->viewDistance - 1};
+
+    // Streamed chunks arrive over the next frames and are uploaded as edits.
+    if (!options->streamChunks) {
+        generateTerrain(min, max);
+    }
+
+    // Full detail is only kept where the traversal can use it, which is up
+    // to the LOD distance from the camera.
+    auto detailDistance = options->voxelLodDistance > 0.0f ? i32(std::ceil(options->voxelLodDistance / f32(ChunkSection::kSize))) : options->viewDistance;
+
+    auto start = std::chrono::steady_clock::now();
+    brickmap = Arc<Brickmap>::alloc(*world, center, options->viewDistance, detailDistance, kVoxelHeight);
+    auto elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Built brickmap for {}x{} chunks ({} bricks, {:.1f} MB) in {:.3f} ms", max.x - min.x + 1, max.z - min.z + 1, brickmap->getBrickCount(), f64(brickmap->getMemoryUsage()) / 1e6, elapsed);
+
+    // Everything edited so far is part of the new pool.
+    world->takeDirtyChunks();
+    pendingBrickmapChunks.clear();
+
+    // The previous buffers may still be read by frames in flight.
+    device->waitIdle();
+
+    brickmapBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        sizeof(u32) * brickmap->getCells().size(),
+        brickmap->getCells().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    brickBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        sizeof(u32) * brickmap->getBricks().size(),
+        brickmap->getBricks().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    brickLodBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        sizeof(u32) * brickmap->getLods().size(),
+        brickmap->getLods().data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+
+    for (auto& resourceGroup : {raytraceResourceGroup, wavefrontExtendResourceGroup, wavefrontConnectResourceGroup}) {
+        resourceGroup->setStorageBuffer(brickmapBuffer, 0, 21);
+        resourceGroup->setStorageBuffer(brickBuffer, 0, 22);
+        resourceGroup->setStorageBuffer(brickLodBuffer, 0, 23);
+    }
+
+    // A dense grid of the same area stores one byte per block.
+    auto gridBytes = u64(max.x - min.x + 1) * u64(max.z - min.z + 1) * u64(ChunkSection::kVolume) * u64(kVoxelHeight / ChunkSection::kSize);
+    voxelSweep->setMemoryUsage(brickmap->getMemoryUsage(), gridBytes);
+}
+
+void GameApplication::uploadBrickmapChanges(vfx::CommandBuffer* cmd) {
+    stagingRing->beginFrame();
+
+    auto chunks = world->takeDirtyChunks();
+    pendingBrickmapChunks.insert(pendingBrickmapChunks.end(), chunks.begin(), chunks.end());
+    if (pendingBrickmapChunks.empty() && brickmap->getDirtyCells().empty()) {
+        return;
+    }
+
+    // A chunk column touches at most this many bytes of the brickmap, chunks
+    // that would not fit into this frame of the ring wait for the next one.
+    static constexpr size_t kBricksPerChunk = (ChunkSection::kSize / Brickmap::kBrickSize) * (ChunkSection::kSize / Brickmap::kBrickSize) * (kVoxelHeight / Brickmap::kBrickSize);
+    static constexpr size_t kMaxChunkBytes = kBricksPerChunk * (Brickmap::kBrickVolume + Brickmap::kLodBytes + sizeof(u32));
+
+    auto start = std::chrono::steady_clock::now();
+    auto getDirtyBytes = [&] {
+        return brickmap->getDirtyCells().size() * sizeof(u32) + brickmap->getDirtyBricks().size() * Brickmap::kBrickVolume + brickmap->getDirtyLods().size() * Brickmap::kLodBytes;
+    };
+    // Cells cleared by a recenter go out in the same frame as the new
+    // header, chunks fill what is left of the region.
+    auto bytes = getDirtyBytes();
+    auto count = size_t(0);
+    for (; count < pendingBrickmapChunks.size() && bytes + kMaxChunkBytes <= stagingRing->getFrameSize(); ++count) {
+        brickmap->updateChunk(*world, pendingBrickmapChunks[count]);
+        bytes = getDirtyBytes();
+    }
+    pendingBrickmapChunks.erase(pendingBrickmapChunks.begin(), pendingBrickmapChunks.begin() + ptrdiff_t(count));
+
+    auto dirtyCells = brickmap->getDirtyCells();
+    auto dirtyBricks = brickmap->getDirtyBricks();
+    auto dirtyLods = brickmap->getDirtyLods();
+    brickmap->clearDirty();
+
+    // Sorted offsets let neighbouring cells and bricks share copy regions.
+    std::sort(dirtyCells.begin(), dirtyCells.end());
+    std::sort(dirtyBricks.begin(), dirtyBricks.end());
+    std::sort(dirtyLods.begin(), dirtyLods.end());
+
+    auto& cells = brickmap->getCells();
+    for (auto cell : dirtyCells) {
+        stagingRing->upload(brickmapBuffer, sizeof(u32) * cell, &cells[cell], sizeof(u32));
+    }
+    auto& bricks = brickmap->getBricks();
+    for (auto brick : dirtyBricks) {
+        stagingRing->upload(brickBuffer, u64(Brickmap::kBrickVolume) * brick, &bricks[size_t(brick) * Brickmap::kBrickWords], Brickmap::kBrickVolume);
+    }
+    auto& lods = brickmap->getLods();
+    for (auto cell : dirtyLods) {
+        stagingRing->upload(brickLodBuffer, u64(Brickmap::kLodBytes) * cell, &lods[size_t(cell) * Brickmap::kLodWords], Brickmap::kLodBytes);
+    }
+    stagingRing->flush(cmd);
+
+    // Streaming uploads every frame, only edits are worth a line in the log.
+    if (!options->streamChunks) {
+        auto elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info("Uploaded {} chunks as {} bytes in {} copy regions in {:.3f} ms, the whole brickmap is {:.1f} MB", count, stagingRing->getUploadedBytes(), stagingRing->getRegionCount(), elapsed, f64(brickmap->getMemoryUsage()) / 1e6);
+    }
+    accumulateFrame = 0;
+}
+
+void GameApplication::updateStreaming() {
+    auto renderSize = getRenderSize();
+    auto projectionMatrix = Camera::getInfinityProjectionMatrix(60.0f, f32(renderSize.width) / f32(renderSize.height), 0.01f);
+    auto worldToCameraMatrix = glm::inverse(glm::translate(glm::mat4(1.0f), cameraPosition) * glm::mat4x4(glm::quat(glm::radians(cameraRotation))));
+    chunkStreamer->update(cameraPosition, projectionMatrix * worldToCameraMatrix, options->viewDistance, size_t(options->chunkMemoryBudget) * 1024 * 1024);
+
+    // The brickmap follows the camera chunk by chunk, the columns that enter
+    // it are uploaded like streamed chunks.
+    auto center = BlockPosition{i32(glm::floor(cameraPosition.x)), 0, i32(glm::floor(cameraPosition.z))}.getChunkPosition();
+    if (center != brickmap->getCenter()) {
+        auto entered = brickmap->recenter(center);
+        pendingBrickmapChunks.insert(pendingBrickmapChunks.end(), entered.begin(), entered.end());
+    }
+}
+
+void GameApplication::updateLights() {
+    lights.clear();
+
+    if (options->manyLights) {
+        // Torch-like lights scattered around the cube, enough of them that
+        // uniform selection almost never picks one that matters.
+        auto generator = std::mt19937{42};
+        auto position = std::uniform_real_distribution<f32>(-20.0f, 20.0f);
+        auto hue = std::uniform_real_distribution<f32>(0.0f, 1.0f);
+
+        while (lights.size() < 10000) {
+            auto p = glm::vec3(position(generator), position(generator), position(generator));
+            if (glm::all(glm::lessThan(glm::abs(p), glm::vec3(1.5f)))) {
+                continue;
+            }
+            auto h = hue(generator);
+            lights.emplace_back(Light{
+                .position = p,
+                .color = glm::vec3(1.0f, 0.5f + 0.5f * h, 0.2f + 0.6f * h),
+                .brightness = 1.0f,
+                .intensity = 20.0f,
+                .radius = 0.05f
+            });
+        }
+    } else {
+        // Small emissive spheres around the cube, sampled explicitly by the tracer.
+        lights = {
+            Light{.position = glm::vec3(+2.5f, +1.5f, +2.5f), .color = glm::vec3(1.0f, 0.6f, 0.3f), .brightness = 1.0f, .intensity = 40.0f, .radius = 0.2f},
+            Light{.position = glm::vec3(-2.5f, +1.5f, +2.5f), .color = glm::vec3(0.3f, 0.6f, 1.0f), .brightness = 1.0f, .intensity = 40.0f, .radius = 0.2f},
+            Light{.position = glm::vec3(+2.5f, -1.5f, -2.5f), .color = glm::vec3(0.4f, 1.0f, 0.4f), .brightness = 1.0f, .intensity = 40.0f, .radius = 0.2f},
+            Light{.position = glm::vec3(-2.5f, -1.5f, -2.5f), .color = glm::vec3(1.0f, 1.0f, 1.0f), .brightness = 1.0f, .intensity = 40.0f, .radius = 0.2f}
+        };
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto tree = LightTree(lights);
+    auto elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Built light tree for {} lights ({} nodes) in {:.3f} ms", lights.size(), tree.getNodes().size(), elapsed);
+
+    // Buffers cannot be empty, without lights they hold one unused element
+    // and the shaders are told there are none.
+    auto lightData = lights.empty() ? std::vector<Light>(1) : lights;
+    auto nodeData = tree.getNodes().empty() ? std::vector<LightTreeNode>(1) : tree.getNodes();
+    auto leafData = tree.getLeaves().empty() ? std::vector<i32>(1) : tree.getLeaves();
+
+    lightBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(Light) * lightData.size(),
+        lightData.data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    lightTreeBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(LightTreeNode) * nodeData.size(),
+        nodeData.data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    lightLeafBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        sizeof(i32) * leafData.size(),
+        leafData.data(),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+
+    for (auto& resourceGroup : {raytraceResourceGroup, wavefrontExtendResourceGroup, wavefrontShadeResourceGroup, wavefrontConnectResourceGroup}) {
+        resourceGroup->setStorageBuffer(lightBuffer, 0, 13);
+        resourceGroup->setStorageBuffer(lightTreeBuffer, 0, 14);
+        resourceGroup->setStorageBuffer(lightLeafBuffer, 0, 15);
+    }
+}
+
+auto GameApplication::getRenderSize() const -> vk::Extent2D {
+    auto scale = glm::clamp(options->renderScale, 0.25f, 1.0f);
+    return vk::Extent2D{
+        .width = std::max(u32(f32(swapchain->drawableSize.width) * scale), 1u),
+        .height = std::max(u32(f32(swapchain->drawableSize.height) * scale), 1u)
+    };
+}
+
 void GameApplication::updateTextureAttachments() {
+    auto renderSize = swapchain->drawableSize;
+
     rayDirections = device->makeBuffer(
         vk::BufferUsageFlagBits::eStorageBuffer,
-        swapchain->drawableSize.width * swapchain->drawableSize.height * sizeof(glm::vec4),
+        renderSize.width * renderSize.height * sizeof(glm::vec4),
         VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
     );
     colorAttachmentTexture = device->makeTexture(vfx::TextureDescription{
         .format = vk::Format::eR32G32B32A32Sfloat,
-        .width = swapchain->drawableSize.width,
-        .height = swapchain->drawableSize.height,
+        .width = renderSize.width,
+        .height = renderSize.height,
         .usage = vk::ImageUsageFlagBits::eColorAttachment
                | vk::ImageUsageFlagBits::eInputAttachment
                | vk::ImageUsageFlagBits::eSampled
@@ -624,14 +1526,56 @@ void GameApplication::updateTextureAttachments() {
     });
     accumulateAttachmentTexture = device->makeTexture(vfx::TextureDescription{
         .format = vk::Format::eR32G32B32A32Sfloat,
-        .width = swapchain->drawableSize.width,
-        .height = swapchain->drawableSize.height,
+        .width = renderSize.width,
+        .height = renderSize.height,
         .usage = vk::ImageUsageFlagBits::eColorAttachment
                | vk::ImageUsageFlagBits::eInputAttachment
                | vk::ImageUsageFlagBits::eSampled
                | vk::ImageUsageFlagBits::eStorage
                | vk::ImageUsageFlagBits::eTransferDst
     });
+    normalDepthAttachmentTexture = device->makeTexture(vfx::TextureDescription{
+        .format = vk::Format::eR32G32B32A32Sfloat,
+        .width = renderSize.width,
+        .height = renderSize.height,
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage
+    });
+    albedoAttachmentTexture = device->makeTexture(vfx::TextureDescription{
+        .format = vk::Format::eR8G8B8A8Unorm,
+        .width = renderSize.width,
+        .height = renderSize.height,
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage
+    });
+    for (auto& historyAttachmentTexture : historyAttachmentTextures) {
+        historyAttachmentTexture = device->makeTexture(vfx::TextureDescription{
+            .format = vk::Format::eR32G32B32A32Sfloat,
+            .width = renderSize.width,
+            .height = renderSize.height,
+            .usage = vk::ImageUsageFlagBits::eStorage
+        });
+    }
+    historyValid = false;
+
+    for (auto& denoiseAttachmentTexture : denoiseAttachmentTextures) {
+        denoiseAttachmentTexture = device->makeTexture(vfx::TextureDescription{
+            .format = vk::Format::eR32G32B32A32Sfloat,
+            .width = renderSize.width,
+            .height = renderSize.height,
+            .usage = vk::ImageUsageFlagBits::eStorage
+        });
+    }
+    wavefrontPathBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        renderSize.width * renderSize.height * sizeof(WavefrontPathState),
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+    );
+    for (auto* queue : {&wavefrontRayQueue, &wavefrontHitQueue, &wavefrontConnectQueue}) {
+        *queue = device->makeBuffer(
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            sizeof(WavefrontQueueHeader) + renderSize.width * renderSize.height * sizeof(u32),
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+        );
+    }
     depthAttachmentTexture = device->makeTexture(vfx::TextureDescription{
         .format = vk::Format::eD32Sfloat,
         .width = swapchain->drawableSize.width,
@@ -639,12 +1583,45 @@ void GameApplication::updateTextureAttachments() {
         .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment | vk::ImageUsageFlagBits::eSampled,
     });
 
-    presentResourceGroup->setSampler(sampler, 0);
+    presentResourceGroup->setSampler(presentSampler, 0);
     presentResourceGroup->setTexture(colorAttachmentTexture, 1);
-//    presentResourceGroup->setTexture(depthAttachmentTexture, 2);
+    presentResourceGroup->setTexture(normalDepthAttachmentTexture, 2);
     raytraceResourceGroup->setStorageImage(colorAttachmentTexture, 0);
     raytraceResourceGroup->setStorageImage(accumulateAttachmentTexture, 1);
     raytraceResourceGroup->setStorageBuffer(rayDirections, 0, 2);
+    raytraceResourceGroup->setStorageImage(normalDepthAttachmentTexture, 7);
+    raytraceResourceGroup->setStorageImage(albedoAttachmentTexture, 8);
+    reconstructResourceGroup->setStorageImage(colorAttachmentTexture, 0);
+    reconstructResourceGroup->setStorageImage(accumulateAttachmentTexture, 1);
+    reconstructResourceGroup->setStorageImage(normalDepthAttachmentTexture, 2);
+    reconstructResourceGroup->setStorageImage(albedoAttachmentTexture, 3);
+    reconstructResourceGroup->setStorageImage(historyAttachmentTextures[0], 4);
+    reconstructResourceGroup->setStorageImage(historyAttachmentTextures[1], 5);
+    reconstructResourceGroup->setStorageBuffer(rayDirections, 0, 6);
+    denoiseResourceGroup->setStorageImage(colorAttachmentTexture, 0);
+    denoiseResourceGroup->setStorageImage(denoiseAttachmentTextures[0], 1);
+    denoiseResourceGroup->setStorageImage(denoiseAttachmentTextures[1], 2);
+    denoiseResourceGroup->setStorageImage(normalDepthAttachmentTexture, 3);
+    denoiseResourceGroup->setStorageImage(albedoAttachmentTexture, 4);
+    wavefrontGenerateResourceGroup->setStorageBuffer(rayDirections, 0, 2);
+    wavefrontGenerateResourceGroup->setStorageImage(normalDepthAttachmentTexture, 7);
+    wavefrontGenerateResourceGroup->setStorageImage(albedoAttachmentTexture, 8);
+    wavefrontGenerateResourceGroup->setStorageBuffer(wavefrontPathBuffer, 0, 9);
+    wavefrontGenerateResourceGroup->setStorageBuffer(wavefrontRayQueue, 0, 10);
+    wavefrontExtendResourceGroup->setStorageBuffer(wavefrontPathBuffer, 0, 9);
+    wavefrontExtendResourceGroup->setStorageBuffer(wavefrontRayQueue, 0, 10);
+    wavefrontExtendResourceGroup->setStorageBuffer(wavefrontHitQueue, 0, 11);
+    wavefrontShadeResourceGroup->setStorageImage(normalDepthAttachmentTexture, 7);
+    wavefrontShadeResourceGroup->setStorageImage(albedoAttachmentTexture, 8);
+    wavefrontShadeResourceGroup->setStorageBuffer(wavefrontPathBuffer, 0, 9);
+    wavefrontShadeResourceGroup->setStorageBuffer(wavefrontRayQueue, 0, 10);
+    wavefrontShadeResourceGroup->setStorageBuffer(wavefrontHitQueue, 0, 11);
+    wavefrontShadeResourceGroup->setStorageBuffer(wavefrontConnectQueue, 0, 12);
+    wavefrontConnectResourceGroup->setStorageBuffer(wavefrontPathBuffer, 0, 9);
+    wavefrontConnectResourceGroup->setStorageBuffer(wavefrontConnectQueue, 0, 12);
+    wavefrontAccumulateResourceGroup->setStorageImage(colorAttachmentTexture, 0);
+    wavefrontAccumulateResourceGroup->setStorageImage(accumulateAttachmentTexture, 1);
+    wavefrontAccumulateResourceGroup->setStorageBuffer(wavefrontPathBuffer, 0, 9);
 }
 
 void GameApplication::createDefaultPipelineObjects() {
@@ -697,10 +1674,68 @@ void GameApplication::createRaytracePipelineObjects() {
     raytracePipelineState = device->makeComputePipelineState(function);
     raytraceResourceGroup = device->makeResourceGroup(raytracePipelineState->descriptorSetLayouts[0], {
         vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1},
-        vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, 1},
+        vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, TextureArray::kMaxTextures},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 4},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 14}
+    });
+}
+
+void GameApplication::createReconstructPipelineObjects() {
+    auto library = device->makeLibrary(Assets::readFile("shaders/reconstruct.comp.spv"));
+    auto function = library->makeFunction("main");
+
+    reconstructPipelineState = device->makeComputePipelineState(function);
+    reconstructResourceGroup = device->makeResourceGroup(reconstructPipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 6},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 1}
+    });
+}
+
+void GameApplication::createDenoisePipelineObjects() {
+    auto library = device->makeLibrary(Assets::readFile("shaders/denoise.comp.spv"));
+    auto function = library->makeFunction("main");
+
+    denoisePipelineState = device->makeComputePipelineState(function);
+    denoiseResourceGroup = device->makeResourceGroup(denoisePipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 5}
+    });
+}
+
+void GameApplication::createWavefrontPipelineObjects() {
+    auto makePipelineState = [&](std::string_view name) {
+        auto library = device->makeLibrary(Assets::readFile(fmt::format("shaders/{}.comp.spv", name)));
+        return device->makeComputePipelineState(library->makeFunction("main"));
+    };
+
+    wavefrontGeneratePipelineState = makePipelineState("wavefront_generate");
+    wavefrontGenerateResourceGroup = device->makeResourceGroup(wavefrontGeneratePipelineState->descriptorSetLayouts[0], {
         vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 2},
         vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 3}
     });
+
+    wavefrontExtendPipelineState = makePipelineState("wavefront_extend");
+    wavefrontExtendResourceGroup = device->makeResourceGroup(wavefrontExtendPipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 14}
+    });
+
+    wavefrontShadePipelineState = makePipelineState("wavefront_shade");
+    wavefrontShadeResourceGroup = device->makeResourceGroup(wavefrontShadePipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1},
+        vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, TextureArray::kMaxTextures},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 2},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 9}
+    });
+
+    wavefrontConnectPipelineState = makePipelineState("wavefront_connect");
+    wavefrontConnectResourceGroup = device->makeResourceGroup(wavefrontConnectPipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 10}
+    });
+
+    wavefrontAccumulatePipelineState = makePipelineState("wavefront_accumulate");
+    wavefrontAccumulateResourceGroup = device->makeResourceGroup(wavefrontAccumulatePipelineState->descriptorSetLayouts[0], {
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, 2},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 1}
+    });
 }
 
 void GameApplication::createPresentPipelineObjects() {
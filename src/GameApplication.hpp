@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Application.hpp"
+#include "Math.hpp"
 
 #include <random>
 
@@ -8,6 +9,20 @@ struct Options;
 struct PlayerInput;
 struct MouseHandler;
 struct ImGuiRenderer;
+struct GpuTimer;
+struct DynamicResolution;
+struct TileSweep;
+struct RaytraceScene;
+struct TextureArray;
+struct World;
+struct Brickmap;
+struct StagingRing;
+struct ChunkStreamer;
+struct RegionStorage;
+struct TerrainGenerator;
+struct ThreadPool;
+struct VoxelSweep;
+struct RaytraceConstants;
 
 struct GameApplication final : Application, WindowDelegate {
 public:
@@ -21,9 +36,22 @@ private:
     void update(f32 dt);
     void render();
     void updateTextureAttachments();
+    void updateLights();
+    void generateTerrain(const ChunkPosition& min, const ChunkPosition& max);
+    void updateBrickmap();
+    void uploadBrickmapChanges(vfx::CommandBuffer* cmd);
+    void updateStreaming();
+    [[nodiscard]]
+    auto getRenderSize() const -> vk::Extent2D;
     void createPresentPipelineObjects();
     void createDefaultPipelineObjects();
     void createRaytracePipelineObjects();
+    void createReconstructPipelineObjects();
+    void createDenoisePipelineObjects();
+    void createWavefrontPipelineObjects();
+    void encodeWavefrontPasses(vfx::CommandBuffer* cmd, const RaytraceConstants& constants, vk::Extent2D dispatchSize);
+    void encodeReconstructPass(vfx::CommandBuffer* cmd, const glm::mat4& viewProjectionMatrix);
+    void encodeDenoisePasses(vfx::CommandBuffer* cmd);
 
 private:
     void windowDidResize() override;
@@ -46,12 +74,29 @@ private:
     Arc<Options> options = {};
     Arc<PlayerInput> playerInput = {};
     Arc<ImGuiRenderer> imguiRenderer = {};
+    Arc<GpuTimer> gpuTimer = {};
+    Arc<DynamicResolution> dynamicResolution = {};
+    Arc<TileSweep> tileSweep = {};
+    Arc<VoxelSweep> voxelSweep = {};
+    Arc<RaytraceScene> raytraceScene = {};
+    Arc<TextureArray> textureArray = {};
+    Arc<World> world = {};
+    Arc<Brickmap> brickmap = {};
+    Arc<StagingRing> stagingRing = {};
+    Arc<ThreadPool> threadPool = {};
+    Arc<TerrainGenerator> terrainGenerator = {};
+    Arc<RegionStorage> regionStorage = {};
+    Arc<ChunkStreamer> chunkStreamer = {};
 
-    Arc<vfx::Texture> texture = {};
     Arc<vfx::Sampler> sampler = {};
+    Arc<vfx::Sampler> presentSampler = {};
     Arc<vfx::Texture> depthAttachmentTexture = {};
     Arc<vfx::Texture> colorAttachmentTexture = {};
     Arc<vfx::Texture> accumulateAttachmentTexture = {};
+    Arc<vfx::Texture> normalDepthAttachmentTexture = {};
+    Arc<vfx::Texture> albedoAttachmentTexture = {};
+    std::array<Arc<vfx::Texture>, 2> historyAttachmentTextures = {};
+    std::array<Arc<vfx::Texture>, 2> denoiseAttachmentTextures = {};
 
     Arc<vfx::Buffer> rayDirections{};
 
@@ -64,8 +109,50 @@ private:
     Arc<vfx::ComputePipelineState> raytracePipelineState = {};
     Arc<vfx::ResourceGroup> raytraceResourceGroup = {};
 
+    Arc<vfx::ComputePipelineState> reconstructPipelineState = {};
+    Arc<vfx::ResourceGroup> reconstructResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> denoisePipelineState = {};
+    Arc<vfx::ResourceGroup> denoiseResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> wavefrontGeneratePipelineState = {};
+    Arc<vfx::ResourceGroup> wavefrontGenerateResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> wavefrontExtendPipelineState = {};
+    Arc<vfx::ResourceGroup> wavefrontExtendResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> wavefrontShadePipelineState = {};
+    Arc<vfx::ResourceGroup> wavefrontShadeResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> wavefrontConnectPipelineState = {};
+    Arc<vfx::ResourceGroup> wavefrontConnectResourceGroup = {};
+
+    Arc<vfx::ComputePipelineState> wavefrontAccumulatePipelineState = {};
+    Arc<vfx::ResourceGroup> wavefrontAccumulateResourceGroup = {};
+
+    Arc<vfx::Buffer> wavefrontPathBuffer = {};
+    Arc<vfx::Buffer> wavefrontRayQueue = {};
+    Arc<vfx::Buffer> wavefrontHitQueue = {};
+    Arc<vfx::Buffer> wavefrontConnectQueue = {};
+
     Arc<vfx::Buffer> raytraceIndexBuffer = {};
-    Arc<vfx::Buffer> raytraceVertexBuffer = {};
+    Arc<vfx::Buffer> raytraceTriangleBuffer = {};
+    Arc<vfx::Buffer> raytraceAttributeBuffer = {};
+    Arc<vfx::Buffer> triangleMaterialBuffer = {};
+    Arc<vfx::Buffer> materialBuffer = {};
+    Arc<vfx::Buffer> lightBuffer = {};
+    Arc<vfx::Buffer> lightTreeBuffer = {};
+    Arc<vfx::Buffer> lightLeafBuffer = {};
+    Arc<vfx::Buffer> voxelGridBuffer = {};
+    Arc<vfx::Buffer> brickmapBuffer = {};
+    Arc<vfx::Buffer> brickBuffer = {};
+    Arc<vfx::Buffer> brickLodBuffer = {};
+
+    std::vector<Light> lights = {};
+    // Voxel blocks beyond it are shaded with the first material.
+    int materialCount = 0;
+    // Dirty chunks that did not fit into the staging ring yet.
+    std::vector<ChunkPosition> pendingBrickmapChunks = {};
 
     Arc<vfx::Buffer> sceneConstantsBuffer = {};
 
@@ -73,6 +160,12 @@ private:
     glm::vec3 cameraRotation = {};
 
     int accumulateFrame = 0;
+    int frameIndex = 0;
+
+    bool historyValid = false;
+    vk::Extent2D historySize = {};
+    glm::vec3 previousCameraPosition = {};
+    glm::mat4 previousViewProjectionMatrix = glm::mat4(1.0f);
 
     volatile bool running = false;
 };
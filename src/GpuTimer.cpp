@@ -0,0 +1,98 @@
+#include "GpuTimer.hpp"
+
+GpuTimer::GpuTimer(const Arc<vfx::Device>& device, u32 framesInFlight, u32 maxScopes) : device(device), maxScopes(maxScopes), frames(framesInFlight) {
+    timestampPeriod = f64(device->gpu.getProperties(device->interface).limits.timestampPeriod);
+
+    for (auto& frame : frames) {
+        frame.queryPool = device->handle->createQueryPoolUnique(vk::QueryPoolCreateInfo{
+            .queryType = vk::QueryType::eTimestamp,
+            .queryCount = maxScopes * 2
+        }, nullptr, device->interface);
+    }
+}
+
+void GpuTimer::beginFrame(vfx::CommandBuffer* cmd) {
+    frameIndex = (frameIndex + 1) % u32(frames.size());
+
+    // The pool we are about to reuse was written a full ring of frames ago,
+    // so its results are normally available without stalling the queue.
+    auto& frame = frames[frameIndex];
+    if (frame.submitted) {
+        readResults(frameIndex);
+    }
+
+    frame.names.clear();
+    frame.submitted = true;
+    cmd->handle->resetQueryPool(*frame.queryPool, 0, maxScopes * 2, device->interface);
+}
+
+void GpuTimer::begin(vfx::CommandBuffer* cmd, std::string name) {
+    auto& frame = frames[frameIndex];
+    if (frame.names.size() >= maxScopes) {
+        return;
+    }
+
+    auto query = u32(frame.names.size()) * 2;
+    frame.names.emplace_back(std::move(name));
+    cmd->handle->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *frame.queryPool, query, device->interface);
+}
+
+void GpuTimer::end(vfx::CommandBuffer* cmd) {
+    auto& frame = frames[frameIndex];
+    if (frame.names.empty() || frame.names.size() > maxScopes) {
+        return;
+    }
+
+    auto query = u32(frame.names.size()) * 2 - 1;
+    cmd->handle->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *frame.queryPool, query, device->interface);
+}
+
+auto GpuTimer::getResults() const -> const std::vector<Result>& {
+    return results;
+}
+
+auto GpuTimer::getTime(std::string_view name) const -> f64 {
+    for (auto& result : results) {
+        if (result.name == name) {
+            return result.milliseconds;
+        }
+    }
+    return 0.0;
+}
+
+auto GpuTimer::getFrameTime() const -> f64 {
+    f64 total = 0.0;
+    for (auto& result : results) {
+        total += result.milliseconds;
+    }
+    return total;
+}
+
+void GpuTimer::readResults(u32 index) {
+    auto& frame = frames[index];
+    if (frame.names.empty()) {
+        return;
+    }
+
+    auto count = u32(frame.names.size()) * 2;
+    auto timestamps = std::vector<u64>(count);
+    auto status = device->handle->getQueryPoolResults(
+        *frame.queryPool,
+        0,
+        count,
+        timestamps.size() * sizeof(u64),
+        timestamps.data(),
+        sizeof(u64),
+        vk::QueryResultFlagBits::e64,
+        device->interface
+    );
+    if (status != vk::Result::eSuccess) {
+        return;
+    }
+
+    results.resize(frame.names.size());
+    for (size_t i = 0; i < frame.names.size(); ++i) {
+        results[i].name = frame.names[i];
+        results[i].milliseconds = f64(timestamps[i * 2 + 1] - timestamps[i * 2 + 0]) * timestampPeriod * 1e-6;
+    }
+}
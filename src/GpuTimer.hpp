@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <string>
+#include <vector>
+
+struct GpuTimer {
+public:
+    struct Result {
+        std::string name = {};
+        f64 milliseconds = 0.0;
+    };
+
+public:
+    // One query pool per frame the swapchain lets the CPU run ahead.
+    GpuTimer(const Arc<vfx::Device>& device, u32 framesInFlight, u32 maxScopes = 32);
+
+public:
+    void beginFrame(vfx::CommandBuffer* cmd);
+    void begin(vfx::CommandBuffer* cmd, std::string name);
+    void end(vfx::CommandBuffer* cmd);
+
+    [[nodiscard]]
+    auto getResults() const -> const std::vector<Result>&;
+
+    [[nodiscard]]
+    auto getTime(std::string_view name) const -> f64;
+
+    [[nodiscard]]
+    auto getFrameTime() const -> f64;
+
+private:
+    void readResults(u32 frame);
+
+private:
+    struct Frame {
+        vk::UniqueQueryPool queryPool = {};
+        std::vector<std::string> names = {};
+        bool submitted = false;
+    };
+
+    Arc<vfx::Device> device;
+
+    u32 maxScopes = 0;
+    u32 frameIndex = 0;
+    f64 timestampPeriod = 0.0;
+
+    std::vector<Frame> frames = {};
+    std::vector<Result> results = {};
+};
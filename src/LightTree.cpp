@@ -0,0 +1,82 @@
+#include "LightTree.hpp"
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+static auto getLightPower(const Light& light) -> f32 {
+    auto radiance = glm::vec3(light.color) * light.brightness * light.intensity;
+    auto luminance = glm::dot(radiance, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+    return luminance * light.radius * light.radius;
+}
+
+LightTree::LightTree(std::span<const Light> lights) {
+    if (lights.empty()) {
+        return;
+    }
+
+    auto indices = std::vector<i32>(lights.size());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    leaves.resize(lights.size());
+    nodes.reserve(lights.size() * 2 - 1);
+    build(lights, indices);
+}
+
+auto LightTree::getLeaves() const -> const std::vector<i32>& {
+    return leaves;
+}
+
+auto LightTree::getNodes() const -> const std::vector<LightTreeNode>& {
+    return nodes;
+}
+
+// Splits at the median of the widest axis of the light centres, which keeps
+// the tree balanced for the dense, evenly spread lights of a voxel world.
+auto LightTree::build(std::span<const Light> lights, std::span<i32> indices) -> i32 {
+    auto index = i32(nodes.size());
+    auto& node = nodes.emplace_back();
+
+    auto boundsMin = glm::vec3(std::numeric_limits<f32>::max());
+    auto boundsMax = glm::vec3(std::numeric_limits<f32>::lowest());
+    auto centerMin = glm::vec3(std::numeric_limits<f32>::max());
+    auto centerMax = glm::vec3(std::numeric_limits<f32>::lowest());
+    auto power = 0.0f;
+
+    for (auto i : indices) {
+        auto& light = lights[i];
+        auto position = glm::vec3(light.position);
+        boundsMin = glm::min(boundsMin, position - light.radius);
+        boundsMax = glm::max(boundsMax, position + light.radius);
+        centerMin = glm::min(centerMin, position);
+        centerMax = glm::max(centerMax, position);
+        power += getLightPower(light);
+    }
+
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.power = power;
+    node.rightChild = -1;
+    node.lightIndex = -1;
+
+    if (indices.size() == 1) {
+        node.lightIndex = indices[0];
+        leaves[size_t(indices[0])] = index;
+        return index;
+    }
+
+    auto extent = centerMax - centerMin;
+    auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    auto middle = indices.size() / 2;
+    std::nth_element(indices.begin(), indices.begin() + ptrdiff_t(middle), indices.end(), [&](i32 a, i32 b) {
+        return lights[a].position[axis] < lights[b].position[axis];
+    });
+
+    build(lights, indices.subspan(0, middle));
+    auto rightChild = build(lights, indices.subspan(middle));
+
+    // The reference may have been invalidated by the recursive calls.
+    nodes[size_t(index)].rightChild = rightChild;
+    return index;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <span>
+#include <vector>
+
+// Mirrors LightTreeNode in raytrace.glsl. Nodes are stored depth-first, so the
+// left child of an inner node always follows it and only the right one is
+// referenced explicitly.
+struct LightTreeNode {
+    float3 boundsMin;
+    float1 power;
+    float3 boundsMax;
+    int1   rightChild;
+    int1   lightIndex;
+};
+
+struct LightTree {
+public:
+    explicit LightTree(std::span<const Light> lights);
+
+public:
+    // Leaf node of every light, used to evaluate the selection pdf of a light
+    // that was hit by a BSDF sample.
+    [[nodiscard]]
+    auto getLeaves() const -> const std::vector<i32>&;
+
+    [[nodiscard]]
+    auto getNodes() const -> const std::vector<LightTreeNode>&;
+
+private:
+    auto build(std::span<const Light> lights, std::span<i32> indices) -> i32;
+
+private:
+    std::vector<i32> leaves = {};
+    std::vector<LightTreeNode> nodes = {};
+};
@@ -0,0 +1,30 @@
+#include "MaterialTable.hpp"
+
+#include <cstring>
+
+MaterialTable::MaterialTable(std::span<const Material> materials) {
+    writeStream<glm::vec4>(Stream::eAlbedo, materials, [](const Material& material) { return glm::vec4(material.albedo); });
+    writeStream<f32>(Stream::eRoughness, materials, [](const Material& material) { return material.roughness; });
+    writeStream<f32>(Stream::eMetallic, materials, [](const Material& material) { return material.metallic; });
+    writeStream<glm::ivec2>(Stream::eTexture, materials, [](const Material& material) { return glm::ivec2(material.textureIndex, material.textureLevels); });
+}
+
+auto MaterialTable::getData() const -> const std::vector<std::byte>& {
+    return data;
+}
+
+auto MaterialTable::getOffset(Stream stream) const -> u64 {
+    return offsets[u32(stream)];
+}
+
+template<typename T>
+void MaterialTable::writeStream(Stream stream, std::span<const Material> materials, auto&& getter) {
+    auto offset = (u64(data.size()) + kStreamAlignment - 1) / kStreamAlignment * kStreamAlignment;
+    offsets[u32(stream)] = offset;
+
+    data.resize(offset + sizeof(T) * std::max(materials.size(), size_t(1)));
+    for (size_t i = 0; i < materials.size(); ++i) {
+        auto value = T(getter(materials[i]));
+        std::memcpy(data.data() + offset + sizeof(T) * i, &value, sizeof(T));
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <span>
+#include <vector>
+
+// Materials are authored as Material structs and stored on the GPU as one
+// stream per property, so a stage only reads the properties it shades with.
+// All streams live in a single buffer, each one bound at its own offset.
+struct MaterialTable {
+public:
+    enum class Stream : u32 {
+        eAlbedo,
+        eRoughness,
+        eMetallic,
+        eTexture,
+    };
+
+    // Covers minStorageBufferOffsetAlignment on every device.
+    static constexpr u64 kStreamAlignment = 256;
+
+public:
+    explicit MaterialTable(std::span<const Material> materials);
+
+public:
+    [[nodiscard]]
+    auto getData() const -> const std::vector<std::byte>&;
+
+    [[nodiscard]]
+    auto getOffset(Stream stream) const -> u64;
+
+private:
+    template<typename T>
+    void writeStream(Stream stream, std::span<const Material> materials, auto&& getter);
+
+private:
+    std::vector<std::byte> data = {};
+    std::array<u64, 4> offsets = {};
+};
@@ -3,6 +3,8 @@
 #include "Core.hpp"
 #include "KeyMapping.hpp"
 
+#include <string>
+
 struct Options {
     Arc<KeyMapping> keyUp = Arc<KeyMapping>::alloc();
     Arc<KeyMapping> keyDown = Arc<KeyMapping>::alloc();
@@ -13,4 +15,36 @@ struct Options {
 
     f32 gamma = 2.2f;
     f32 exposure = 1.0f;
+    f32 renderScale = 1.0f;
+    bool edgeAwareUpsampling = true;
+    i32 maxBounces = 4;
+    i32 rouletteDepth = 2;
+    bool wavefront = false;
+    bool nextEventEstimation = true;
+    bool lightTree = true;
+    bool manyLights = false;
+    // 0 traces the triangle scene, 1 the dense voxel grid, 2 the brickmap.
+    i32 voxelMode = 0;
+    i32 viewDistance = 8;
+    // Blocks from the camera where the brickmap switches to coarser voxels,
+    // only chunks within it keep full detail. Zero keeps full detail
+    // everywhere.
+    f32 voxelLodDistance = 128.0f;
+    bool streamChunks = false;
+    // Directory of the region files edited chunks are saved to.
+    std::string worldDirectory = "world";
+    // Megabytes of chunk data the streamer keeps loaded.
+    i32 chunkMemoryBudget = 512;
+    i32 interleave = 1;
+    i32 tileWidth = 8;
+    i32 tileHeight = 8;
+    bool mortonOrder = true;
+    bool dynamicResolution = false;
+    f32 targetFrameTime = 16.6f;
+
+    bool denoise = false;
+    i32 denoiseIterations = 4;
+    f32 denoiseColorPhi = 4.0f;
+    f32 denoiseNormalPhi = 128.0f;
+    f32 denoiseDepthPhi = 0.1f;
 };
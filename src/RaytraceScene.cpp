@@ -0,0 +1,134 @@
+#include "RaytraceScene.hpp"
+
+#include "glm/gtc/packing.hpp"
+
+static auto encodeOctahedral(const glm::vec3& normal) -> glm::vec2 {
+    auto n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+    auto e = glm::vec2(n.x, n.y);
+    if (n.z < 0.0f) {
+        auto sign = glm::vec2(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * sign;
+    }
+    return e;
+}
+
+RaytraceScene::RaytraceScene(std::vector<RaytraceVertex> vertices, std::vector<i32> indices, std::vector<u16> materials) : vertices(std::move(vertices)), indices(std::move(indices)), materials(std::move(materials)) {
+    this->materials.resize((this->indices.size() / 3 + 1) & ~size_t(1));
+
+    triangles.reserve(this->indices.size() / 3);
+    for (size_t i = 0; i < this->indices.size(); i += 3) {
+        auto v0 = glm::vec3(this->vertices[size_t(this->indices[i + 0])].position);
+        auto v1 = glm::vec3(this->vertices[size_t(this->indices[i + 1])].position);
+        auto v2 = glm::vec3(this->vertices[size_t(this->indices[i + 2])].position);
+        triangles.emplace_back(RaytraceTriangle{
+            .v0 = glm::vec4(v0, 0.0f),
+            .edge1 = glm::vec4(v1 - v0, 0.0f),
+            .edge2 = glm::vec4(v2 - v0, 0.0f)
+        });
+    }
+
+    packedAttributes.reserve(this->vertices.size());
+    for (auto& vertex : this->vertices) {
+        packedAttributes.emplace_back(PackedVertexAttributes{
+            .normal = glm::packSnorm2x16(encodeOctahedral(glm::normalize(glm::vec3(vertex.normal)))),
+            .texcoord = glm::packHalf2x16(glm::vec2(vertex.texcoord))
+        });
+    }
+}
+
+auto RaytraceScene::trace(const glm::vec3& origin, const glm::vec3& direction, f32 maxDistance) const -> std::optional<RaytraceHit> {
+    auto distance = maxDistance;
+    auto closest = std::optional<size_t>{};
+    auto barycentrics = glm::vec2();
+
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        if (intersectTriangle(origin, direction, triangles[i], distance, barycentrics)) {
+            closest = i;
+        }
+    }
+
+    if (!closest) {
+        return std::nullopt;
+    }
+
+    // Every accepted hit is closer than the previous one, so the barycentrics
+    // left over belong to the closest triangle and are interpolated once.
+    auto& v0 = vertices[size_t(indices[*closest * 3 + 0])];
+    auto& v1 = vertices[size_t(indices[*closest * 3 + 1])];
+    auto& v2 = vertices[size_t(indices[*closest * 3 + 2])];
+
+    auto weights = glm::vec3(1.0f - barycentrics.x - barycentrics.y, barycentrics.x, barycentrics.y);
+    return RaytraceHit{
+        .distance = distance,
+        .position = origin + direction * distance,
+        .normal = glm::normalize(weights.x * glm::vec3(v0.normal) + weights.y * glm::vec3(v1.normal) + weights.z * glm::vec3(v2.normal)),
+        .texcoord = weights.x * glm::vec2(v0.texcoord) + weights.y * glm::vec2(v1.texcoord) + weights.z * glm::vec2(v2.texcoord),
+        .material = materials[*closest]
+    };
+}
+
+auto RaytraceScene::isOccluded(const glm::vec3& origin, const glm::vec3& direction, f32 maxDistance) const -> bool {
+    auto barycentrics = glm::vec2();
+    for (auto& triangle : triangles) {
+        auto distance = maxDistance;
+        if (intersectTriangle(origin, direction, triangle, distance, barycentrics)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto RaytraceScene::getVertices() const -> const std::vector<RaytraceVertex>& {
+    return vertices;
+}
+
+auto RaytraceScene::getIndices() const -> const std::vector<i32>& {
+    return indices;
+}
+
+auto RaytraceScene::getTriangles() const -> const std::vector<RaytraceTriangle>& {
+    return triangles;
+}
+
+auto RaytraceScene::getPackedAttributes() const -> const std::vector<PackedVertexAttributes>& {
+    return packedAttributes;
+}
+
+auto RaytraceScene::getMaterials() const -> const std::vector<u16>& {
+    return materials;
+}
+
+// Same test as intersectTriangle() in raytrace.glsl, the barycentrics are the
+// weights of v1 and v2.
+auto RaytraceScene::intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const RaytraceTriangle& triangle, f32& distance, glm::vec2& barycentrics) const -> bool {
+    auto edge1 = glm::vec3(triangle.edge1);
+    auto edge2 = glm::vec3(triangle.edge2);
+
+    auto pvec = glm::cross(direction, edge2);
+    auto det = glm::dot(edge1, pvec);
+    if (glm::abs(det) < 1e-5f) {
+        return false;
+    }
+    auto inverseDet = 1.0f / det;
+
+    auto tvec = origin - glm::vec3(triangle.v0);
+    auto u = glm::dot(tvec, pvec) * inverseDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    auto qvec = glm::cross(tvec, edge1);
+    auto v = glm::dot(direction, qvec) * inverseDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+
+    auto d = glm::dot(edge2, qvec) * inverseDet;
+    if (d < 0.0f || distance < d) {
+        return false;
+    }
+
+    distance = d;
+    barycentrics = glm::vec2(u, v);
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <vector>
+#include <optional>
+
+struct RaytraceVertex {
+    float3 position = {};
+    float3 normal   = {};
+    float2 texcoord = {};
+};
+
+// Shading attributes of a vertex as the GPU reads them: an octahedral normal
+// in two snorm16 and the texcoord in two halfs.
+struct PackedVertexAttributes {
+    u32 normal = 0;
+    u32 texcoord = 0;
+};
+
+// Intersection-only copy of a triangle, one vertex and the two edges from it,
+// so the hot loop never touches indices or shading attributes.
+struct RaytraceTriangle {
+    glm::vec4 v0 = {};
+    glm::vec4 edge1 = {};
+    glm::vec4 edge2 = {};
+};
+
+struct RaytraceHit {
+    f32 distance = 0.0f;
+    glm::vec3 position = {};
+    glm::vec3 normal = {};
+    glm::vec2 texcoord = {};
+    u32 material = 0;
+};
+
+// CPU copy of the triangles the raytracer sees, queried with the same
+// intersection test as raytrace.glsl. Distances are in units of the ray
+// direction, which does not need to be normalized.
+struct RaytraceScene {
+public:
+    RaytraceScene(std::vector<RaytraceVertex> vertices, std::vector<i32> indices, std::vector<u16> materials);
+
+public:
+    [[nodiscard]]
+    auto trace(const glm::vec3& origin, const glm::vec3& direction, f32 maxDistance) const -> std::optional<RaytraceHit>;
+
+    // Any-hit query for shadow and occlusion rays, returns on the first
+    // triangle closer than maxDistance and never interpolates attributes.
+    [[nodiscard]]
+    auto isOccluded(const glm::vec3& origin, const glm::vec3& direction, f32 maxDistance) const -> bool;
+
+    [[nodiscard]]
+    auto getVertices() const -> const std::vector<RaytraceVertex>&;
+
+    [[nodiscard]]
+    auto getIndices() const -> const std::vector<i32>&;
+
+    // 48 bytes per triangle, in index buffer order.
+    [[nodiscard]]
+    auto getTriangles() const -> const std::vector<RaytraceTriangle>&;
+
+    // Only the closest hit reads these, through the index buffer.
+    [[nodiscard]]
+    auto getPackedAttributes() const -> const std::vector<PackedVertexAttributes>&;
+
+    // One material per triangle, padded to an even count so that the GPU can
+    // read them as pairs packed into 32-bit words.
+    [[nodiscard]]
+    auto getMaterials() const -> const std::vector<u16>&;
+
+private:
+    [[nodiscard]]
+    auto intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const RaytraceTriangle& triangle, f32& distance, glm::vec2& barycentrics) const -> bool;
+
+private:
+    std::vector<RaytraceVertex> vertices = {};
+    std::vector<i32> indices = {};
+    std::vector<u16> materials = {};
+    std::vector<RaytraceTriangle> triangles = {};
+    std::vector<PackedVertexAttributes> packedAttributes = {};
+};
@@ -0,0 +1,209 @@
+#include "RegionStorage.hpp"
+#include "Compression.hpp"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr u32 kRegionMagic = 0x4E474552; // "REGN"
+static constexpr u32 kRegionVersion = 1;
+
+struct RegionEntry {
+    u32 offset;
+    u32 size;
+    u32 rawSize;
+    u32 reserved;
+};
+
+struct RegionHeader {
+    u32 magic;
+    u32 version;
+    u32 reserved[2];
+    RegionEntry entries[RegionStorage::kRegionChunks];
+};
+
+// Read-only view of a whole region file, unmapped with the last reference.
+struct RegionMapping {
+    const u8* data;
+    size_t size;
+
+    RegionMapping(const void* data, size_t size) : data(static_cast<const u8*>(data)), size(size) {}
+    RegionMapping(const RegionMapping&) = delete;
+
+    ~RegionMapping() {
+        munmap(const_cast<u8*>(data), size);
+    }
+};
+
+struct RegionStorage::Region {
+    std::mutex guard = {};
+    int file = -1;
+    u64 fileSize = 0;
+    RegionHeader header = {};
+    // Dropped after every save and mapped again by the next load.
+    std::shared_ptr<const RegionMapping> mapping = {};
+
+    ~Region() {
+        if (file != -1) {
+            close(file);
+        }
+    }
+};
+
+static auto getRegionPosition(const ChunkPosition& position) -> ChunkPosition {
+    return ChunkPosition{position.x >> 5, position.z >> 5};
+}
+
+static auto getEntryIndex(const ChunkPosition& position) -> size_t {
+    return size_t(position.z & (RegionStorage::kRegionSize - 1)) * RegionStorage::kRegionSize + size_t(position.x & (RegionStorage::kRegionSize - 1));
+}
+
+static void writeAll(int file, const void* data, size_t size, u64 offset) {
+    auto bytes = static_cast<const u8*>(data);
+    while (size != 0) {
+        auto written = pwrite(file, bytes, size, off_t(offset));
+        if (written < 0) {
+            throw std::runtime_error(fmt::format("Failed to write region file: {}", std::strerror(errno)));
+        }
+        bytes += written;
+        size -= size_t(written);
+        offset += u64(written);
+    }
+}
+
+RegionStorage::RegionStorage(std::filesystem::path directory) : directory(std::move(directory)) {}
+
+RegionStorage::~RegionStorage() = default;
+
+auto RegionStorage::getRegion(const ChunkPosition& regionPosition, bool create) -> std::shared_ptr<Region> {
+    std::unique_lock lock{guard};
+
+    // Regions without a usable file are remembered so loads of chunks that
+    // were never saved do not try to open the file every time.
+    auto cached = regions.find(regionPosition);
+    if (cached != nullptr && (*cached)->file != -1) {
+        return *cached;
+    }
+    if (cached != nullptr && !create) {
+        return nullptr;
+    }
+
+    auto path = directory / fmt::format("r.{}.{}.bin", regionPosition.x, regionPosition.z);
+    auto region = std::make_shared<Region>();
+
+    region->file = open(path.c_str(), O_RDWR);
+    if (region->file == -1) {
+        if (!create) {
+            regions.insert(regionPosition, std::make_shared<Region>());
+            return nullptr;
+        }
+        std::filesystem::create_directories(directory);
+        region->file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (region->file == -1) {
+            throw std::runtime_error(fmt::format("Failed to create region file {}: {}", path.string(), std::strerror(errno)));
+        }
+        region->header.magic = kRegionMagic;
+        region->header.version = kRegionVersion;
+        writeAll(region->file, &region->header, sizeof(RegionHeader), 0);
+        region->fileSize = sizeof(RegionHeader);
+    } else {
+        struct stat info = {};
+        fstat(region->file, &info);
+        region->fileSize = u64(info.st_size);
+
+        // A damaged table makes every chunk of the region read as missing,
+        // the file is left alone instead of being overwritten by a save.
+        if (pread(region->file, &region->header, sizeof(RegionHeader), 0) != ssize_t(sizeof(RegionHeader))
+            || region->header.magic != kRegionMagic
+            || region->header.version != kRegionVersion) {
+            if (create) {
+                throw std::runtime_error(fmt::format("Region file {} is damaged", path.string()));
+            }
+            regions.insert(regionPosition, std::make_shared<Region>());
+            return nullptr;
+        }
+    }
+
+    regions.insert(regionPosition, region);
+    return region;
+}
+
+auto RegionStorage::loadChunk(const ChunkPosition& position) -> std::unique_ptr<Chunk> {
+    auto region = getRegion(getRegionPosition(position), false);
+    if (region == nullptr) {
+        return nullptr;
+    }
+
+    auto entry = RegionEntry{};
+    auto mapping = std::shared_ptr<const RegionMapping>();
+    {
+        std::unique_lock lock{region->guard};
+        entry = region->header.entries[getEntryIndex(position)];
+        if (entry.size == 0) {
+            return nullptr;
+        }
+        if (region->mapping == nullptr) {
+            auto data = mmap(nullptr, size_t(region->fileSize), PROT_READ, MAP_SHARED, region->file, 0);
+            if (data == MAP_FAILED) {
+                return nullptr;
+            }
+            region->mapping = std::make_shared<RegionMapping>(data, size_t(region->fileSize));
+        }
+        mapping = region->mapping;
+    }
+
+    if (u64(entry.offset) + entry.size > mapping->size || entry.rawSize > Chunk::kMaxSerializedSize) {
+        return nullptr;
+    }
+
+    thread_local auto buffer = std::vector<u8>();
+    buffer.resize(entry.rawSize);
+    if (!decompress(std::span(mapping->data + entry.offset, entry.size), buffer)) {
+        return nullptr;
+    }
+    return Chunk::deserialize(position, buffer);
+}
+
+void RegionStorage::saveChunk(const Chunk& chunk) {
+    auto raw = std::vector<u8>();
+    chunk.serialize(raw);
+    auto payload = compress(raw);
+
+    auto region = getRegion(getRegionPosition(chunk.getPosition()), true);
+
+    std::unique_lock lock{region->guard};
+
+    // Table offsets are 32 bits and old payloads are never reclaimed, a
+    // region that reached 4 GiB takes no more saves.
+    if (region->fileSize + payload.size() > std::numeric_limits<u32>::max()) {
+        throw std::runtime_error(fmt::format("Region file of chunk {} {} is full", chunk.getPosition().x, chunk.getPosition().z));
+    }
+
+    // The table only points at the payload once it is written, a failed
+    // write leaves the previous payload of the chunk in place.
+    auto index = getEntryIndex(chunk.getPosition());
+    auto entry = RegionEntry{
+        .offset = u32(region->fileSize),
+        .size = u32(payload.size()),
+        .rawSize = u32(raw.size()),
+        .reserved = 0
+    };
+    writeAll(region->file, payload.data(), payload.size(), region->fileSize);
+    writeAll(region->file, &entry, sizeof(RegionEntry), offsetof(RegionHeader, entries) + sizeof(RegionEntry) * index);
+    region->header.entries[index] = entry;
+    region->fileSize += payload.size();
+
+    // Loads that still hold the old mapping keep reading the old payload.
+    region->mapping = nullptr;
+}
+
+auto RegionStorage::getDirectory() const -> const std::filesystem::path& {
+    return directory;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "World.hpp"
+
+#include <mutex>
+#include <filesystem>
+
+// Chunks persisted in region files of 32x32 chunks. A file starts with a
+// table holding the offset and sizes of every chunk, followed by the
+// compressed chunk payloads. Saving appends the new payload and rewrites
+// the table entry, space of the old payload is not reclaimed.
+//
+// Regions are memory mapped for reading, a chunk is decompressed straight
+// out of the mapping so loads never copy the file through a buffer. Loads
+// and saves may run on any thread.
+struct RegionStorage {
+public:
+    static constexpr i32 kRegionSize = 32;
+    static constexpr i32 kRegionChunks = kRegionSize * kRegionSize;
+
+public:
+    explicit RegionStorage(std::filesystem::path directory);
+    ~RegionStorage();
+
+public:
+    // Returns null when the chunk was never saved or its data is damaged.
+    [[nodiscard]]
+    auto loadChunk(const ChunkPosition& position) -> std::unique_ptr<Chunk>;
+
+    // Throws when the region file cannot be created or written.
+    void saveChunk(const Chunk& chunk);
+
+    [[nodiscard]]
+    auto getDirectory() const -> const std::filesystem::path&;
+
+private:
+    struct Region;
+
+    // Opens the region on first use. Without create it is null when there
+    // is no usable file, with create a missing file is created and a
+    // damaged one throws.
+    auto getRegion(const ChunkPosition& regionPosition, bool create) -> std::shared_ptr<Region>;
+
+private:
+    std::filesystem::path directory;
+
+    std::mutex guard = {};
+    ChunkMap<std::shared_ptr<Region>> regions = {};
+};
@@ -0,0 +1,102 @@
+#include "StagingRing.hpp"
+
+#include <algorithm>
+
+StagingRing::StagingRing(const Arc<vfx::Device>& device, u64 frameSize, u32 framesInFlight) : device(device), frameSize(frameSize), framesInFlight(framesInFlight) {
+    stagingBuffer = device->makeBuffer(
+        vk::BufferUsageFlagBits::eTransferSrc,
+        frameSize * framesInFlight,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+    );
+}
+
+void StagingRing::beginFrame() {
+    // The region we are about to reuse was consumed a full ring of frames ago.
+    frameIndex = (frameIndex + 1) % framesInFlight;
+    head = 0;
+}
+
+auto StagingRing::upload(const Arc<vfx::Buffer>& buffer, u64 offset, const void* data, u64 size) -> bool {
+    if (head + size > frameSize) {
+        return false;
+    }
+
+    auto srcOffset = u64(frameIndex) * frameSize + head;
+    stagingBuffer->update(data, size, srcOffset);
+    head = (head + size + 3) & ~u64(3);
+
+    // Neighbouring words written one after another become one region.
+    if (!copies.empty()) {
+        auto& last = copies.back();
+        if (last.buffer == buffer->handle && last.region.srcOffset + last.region.size == srcOffset && last.region.dstOffset + last.region.size == offset) {
+            last.region.size += size;
+            return true;
+        }
+    }
+    copies.emplace_back(Copy{
+        .buffer = buffer->handle,
+        .region = vk::BufferCopy{.srcOffset = srcOffset, .dstOffset = offset, .size = size}
+    });
+    return true;
+}
+
+void StagingRing::flush(vfx::CommandBuffer* cmd) {
+    uploadedBytes = 0;
+    regionCount = copies.size();
+    if (copies.empty()) {
+        return;
+    }
+
+    std::stable_sort(copies.begin(), copies.end(), [](const Copy& a, const Copy& b) {
+        return a.buffer < b.buffer;
+    });
+
+    // Compute passes of earlier frames may still read the words being
+    // overwritten.
+    auto readBarrier = vk::MemoryBarrier2{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+    };
+    cmd->handle->pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &readBarrier
+    }, device->interface);
+
+    auto regions = std::vector<vk::BufferCopy>();
+    for (size_t i = 0; i < copies.size();) {
+        regions.clear();
+        auto j = i;
+        for (; j < copies.size() && copies[j].buffer == copies[i].buffer; ++j) {
+            regions.emplace_back(copies[j].region);
+            uploadedBytes += copies[j].region.size;
+        }
+        cmd->handle->copyBuffer(stagingBuffer->handle, copies[i].buffer, regions, device->interface);
+        i = j;
+    }
+    copies.clear();
+
+    auto memoryBarrier = vk::MemoryBarrier2{
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead
+    };
+    cmd->handle->pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &memoryBarrier
+    }, device->interface);
+}
+
+auto StagingRing::getFrameSize() const -> u64 {
+    return frameSize;
+}
+
+auto StagingRing::getUploadedBytes() const -> u64 {
+    return uploadedBytes;
+}
+
+auto StagingRing::getRegionCount() const -> size_t {
+    return regionCount;
+}
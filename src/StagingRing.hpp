@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <vector>
+
+// Host visible buffer split into one region per frame in flight. Uploads are
+// written into the region of the current frame and recorded as copies that
+// flush issues with a single copy command per destination, so buffers the
+// GPU may still be reading are only ever written by the transfer queue.
+struct StagingRing {
+public:
+    // framesInFlight regions of frameSize bytes, as many as the swapchain
+    // lets the CPU run ahead.
+    StagingRing(const Arc<vfx::Device>& device, u64 frameSize, u32 framesInFlight);
+
+public:
+    void beginFrame();
+
+    // Returns false when the region of this frame has no room left.
+    auto upload(const Arc<vfx::Buffer>& buffer, u64 offset, const void* data, u64 size) -> bool;
+
+    // Records the queued copies between a barrier that waits for compute
+    // shaders of earlier frames to finish reading the destinations and one
+    // that makes the copies visible to compute shaders.
+    void flush(vfx::CommandBuffer* cmd);
+
+    [[nodiscard]]
+    auto getFrameSize() const -> u64;
+
+    // Bytes and copy regions issued by the last flush.
+    [[nodiscard]]
+    auto getUploadedBytes() const -> u64;
+
+    [[nodiscard]]
+    auto getRegionCount() const -> size_t;
+
+private:
+    struct Copy {
+        vk::Buffer buffer = {};
+        vk::BufferCopy region = {};
+    };
+
+    Arc<vfx::Device> device;
+    Arc<vfx::Buffer> stagingBuffer;
+
+    u64 frameSize = 0;
+    u32 framesInFlight = 0;
+    u32 frameIndex = 0;
+    u64 head = 0;
+
+    std::vector<Copy> copies = {};
+    u64 uploadedBytes = 0;
+    size_t regionCount = 0;
+};
@@ -0,0 +1,257 @@
+#include "TerrainGenerator.hpp"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TERRAIN_GENERATOR_AVX2 1
+#include <immintrin.h>
+#endif
+
+static constexpr i32 kBaseHeight = 24;
+static constexpr f32 kHeightScale = 12.0f;
+static constexpr f32 kHeightFrequency = 1.0f / 64.0f;
+static constexpr i32 kHeightOctaves = 4;
+static constexpr f32 kCaveFrequency = 1.0f / 24.0f;
+static constexpr f32 kCaveThreshold = 0.3f;
+
+// Integer hash of a lattice point, the low four bits pick the gradient.
+static auto hashLattice(i32 x, i32 y, i32 z, u32 seed) -> u32 {
+    auto h = seed ^ (u32(x) * 0x8DA6B343u) ^ (u32(y) * 0xD8163841u) ^ (u32(z) * 0xCB1AB31Fu);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+// One of the twelve cube edge directions (four of them twice) dotted with the offset.
+static auto getGradient(u32 h, f32 x, f32 y, f32 z) -> f32 {
+    h &= 15;
+    auto u = h < 8 ? x : y;
+    auto v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) != 0 ? -u : u) + ((h & 2) != 0 ? -v : v);
+}
+
+static auto fade(f32 t) -> f32 {
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static auto lerp(f32 a, f32 b, f32 t) -> f32 {
+    return a + t * (b - a);
+}
+
+// Samples first to count of the points start + i * step.
+static void fillNoiseRange(glm::vec3 start, glm::vec3 step, i32 first, i32 count, u32 seed, f32* out) {
+    for (i32 i = first; i < count; ++i) {
+        auto x = start.x + f32(i) * step.x;
+        auto y = start.y + f32(i) * step.y;
+        auto z = start.z + f32(i) * step.z;
+
+        auto fx = std::floor(x);
+        auto fy = std::floor(y);
+        auto fz = std::floor(z);
+        auto ix = i32(fx);
+        auto iy = i32(fy);
+        auto iz = i32(fz);
+        x -= fx;
+        y -= fy;
+        z -= fz;
+
+        auto n000 = getGradient(hashLattice(ix + 0, iy + 0, iz + 0, seed), x - 0.0f, y - 0.0f, z - 0.0f);
+        auto n100 = getGradient(hashLattice(ix + 1, iy + 0, iz + 0, seed), x - 1.0f, y - 0.0f, z - 0.0f);
+        auto n010 = getGradient(hashLattice(ix + 0, iy + 1, iz + 0, seed), x - 0.0f, y - 1.0f, z - 0.0f);
+        auto n110 = getGradient(hashLattice(ix + 1, iy + 1, iz + 0, seed), x - 1.0f, y - 1.0f, z - 0.0f);
+        auto n001 = getGradient(hashLattice(ix + 0, iy + 0, iz + 1, seed), x - 0.0f, y - 0.0f, z - 1.0f);
+        auto n101 = getGradient(hashLattice(ix + 1, iy + 0, iz + 1, seed), x - 1.0f, y - 0.0f, z - 1.0f);
+        auto n011 = getGradient(hashLattice(ix + 0, iy + 1, iz + 1, seed), x - 0.0f, y - 1.0f, z - 1.0f);
+        auto n111 = getGradient(hashLattice(ix + 1, iy + 1, iz + 1, seed), x - 1.0f, y - 1.0f, z - 1.0f);
+
+        auto u = fade(x);
+        auto v = fade(y);
+        auto w = fade(z);
+        out[i] = lerp(
+            lerp(lerp(n000, n100, u), lerp(n010, n110, u), v),
+            lerp(lerp(n001, n101, u), lerp(n011, n111, u), v),
+            w
+        );
+    }
+}
+
+static void fillNoiseScalar(glm::vec3 start, glm::vec3 step, i32 count, u32 seed, f32* out) {
+    fillNoiseRange(start, step, 0, count, seed, out);
+}
+
+#if TERRAIN_GENERATOR_AVX2
+
+// The same operations as the scalar path in the same order, no FMA so both
+// round identically.
+[[gnu::target("avx2")]]
+static auto hashLattice8(__m256i x, __m256i y, __m256i z, __m256i seed) -> __m256i {
+    auto h = _mm256_xor_si256(seed, _mm256_mullo_epi32(x, _mm256_set1_epi32(i32(0x8DA6B343u))));
+    h = _mm256_xor_si256(h, _mm256_mullo_epi32(y, _mm256_set1_epi32(i32(0xD8163841u))));
+    h = _mm256_xor_si256(h, _mm256_mullo_epi32(z, _mm256_set1_epi32(i32(0xCB1AB31Fu))));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(i32(0x2C1B3C6Du)));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+    return h;
+}
+
+[[gnu::target("avx2")]]
+static auto getGradient8(__m256i h, __m256 x, __m256 y, __m256 z) -> __m256 {
+    h = _mm256_and_si256(h, _mm256_set1_epi32(15));
+    auto below8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    auto below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    auto isX = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))
+    ));
+    auto u = _mm256_blendv_ps(y, x, below8);
+    auto v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, isX), y, below4);
+
+    // Bits 0 and 1 of the hash moved to the sign bit flip u and v.
+    auto signU = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+    auto signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31));
+    return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+}
+
+[[gnu::target("avx2")]]
+static auto fade8(__m256 t) -> __m256 {
+    auto inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+[[gnu::target("avx2")]]
+static auto lerp8(__m256 a, __m256 b, __m256 t) -> __m256 {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+[[gnu::target("avx2")]]
+static void fillNoiseAvx2(glm::vec3 start, glm::vec3 step, i32 count, u32 seed, f32* out) {
+    auto lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    auto seeds = _mm256_set1_epi32(i32(seed));
+    auto one = _mm256_set1_epi32(1);
+    auto onef = _mm256_set1_ps(1.0f);
+
+    i32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto index = _mm256_add_ps(_mm256_set1_ps(f32(i)), lanes);
+        auto x = _mm256_add_ps(_mm256_set1_ps(start.x), _mm256_mul_ps(index, _mm256_set1_ps(step.x)));
+        auto y = _mm256_add_ps(_mm256_set1_ps(start.y), _mm256_mul_ps(index, _mm256_set1_ps(step.y)));
+        auto z = _mm256_add_ps(_mm256_set1_ps(start.z), _mm256_mul_ps(index, _mm256_set1_ps(step.z)));
+
+        auto fx = _mm256_floor_ps(x);
+        auto fy = _mm256_floor_ps(y);
+        auto fz = _mm256_floor_ps(z);
+        auto ix0 = _mm256_cvttps_epi32(fx);
+        auto iy0 = _mm256_cvttps_epi32(fy);
+        auto iz0 = _mm256_cvttps_epi32(fz);
+        auto ix1 = _mm256_add_epi32(ix0, one);
+        auto iy1 = _mm256_add_epi32(iy0, one);
+        auto iz1 = _mm256_add_epi32(iz0, one);
+        auto x0 = _mm256_sub_ps(x, fx);
+        auto y0 = _mm256_sub_ps(y, fy);
+        auto z0 = _mm256_sub_ps(z, fz);
+        auto x1 = _mm256_sub_ps(x0, onef);
+        auto y1 = _mm256_sub_ps(y0, onef);
+        auto z1 = _mm256_sub_ps(z0, onef);
+
+        auto n000 = getGradient8(hashLattice8(ix0, iy0, iz0, seeds), x0, y0, z0);
+        auto n100 = getGradient8(hashLattice8(ix1, iy0, iz0, seeds), x1, y0, z0);
+        auto n010 = getGradient8(hashLattice8(ix0, iy1, iz0, seeds), x0, y1, z0);
+        auto n110 = getGradient8(hashLattice8(ix1, iy1, iz0, seeds), x1, y1, z0);
+        auto n001 = getGradient8(hashLattice8(ix0, iy0, iz1, seeds), x0, y0, z1);
+        auto n101 = getGradient8(hashLattice8(ix1, iy0, iz1, seeds), x1, y0, z1);
+        auto n011 = getGradient8(hashLattice8(ix0, iy1, iz1, seeds), x0, y1, z1);
+        auto n111 = getGradient8(hashLattice8(ix1, iy1, iz1, seeds), x1, y1, z1);
+
+        auto u = fade8(x0);
+        auto v = fade8(y0);
+        auto w = fade8(z0);
+        auto result = lerp8(
+            lerp8(lerp8(n000, n100, u), lerp8(n010, n110, u), v),
+            lerp8(lerp8(n001, n101, u), lerp8(n011, n111, u), v),
+            w
+        );
+        _mm256_storeu_ps(out + i, result);
+    }
+
+    fillNoiseRange(start, step, i, count, seed, out);
+}
+
+#endif
+
+TerrainGenerator::TerrainGenerator(u32 seed, bool allowSimd) : seed(seed), fillNoise(fillNoiseScalar) {
+#if TERRAIN_GENERATOR_AVX2
+    if (allowSimd && isSimdSupported()) {
+        fillNoise = fillNoiseAvx2;
+    }
+#endif
+}
+
+auto TerrainGenerator::generate(const ChunkPosition& position) const -> std::unique_ptr<Chunk> {
+    auto chunk = std::make_unique<Chunk>(position);
+    auto originX = f32(position.getBlockPositionX(0));
+    auto originZ = f32(position.getBlockPositionZ(0));
+
+    // Fractal heightmap, one row of sixteen columns per call and octave.
+    auto heights = std::array<i32, ChunkSection::kSize * ChunkSection::kSize>();
+    auto row = std::array<f32, ChunkSection::kSize>();
+    for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+        auto sum = std::array<f32, ChunkSection::kSize>();
+        auto frequency = kHeightFrequency;
+        auto amplitude = 1.0f;
+        for (i32 octave = 0; octave < kHeightOctaves; ++octave) {
+            fillNoise(glm::vec3(originX * frequency, 0.5f, (originZ + f32(z)) * frequency), glm::vec3(frequency, 0.0f, 0.0f), ChunkSection::kSize, seed + u32(octave), row.data());
+            for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                sum[size_t(x)] += row[size_t(x)] * amplitude;
+            }
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+            heights[size_t(z * ChunkSection::kSize + x)] = std::clamp(kBaseHeight + i32(sum[size_t(x)] * kHeightScale * 2.0f), 1, Chunk::kHeight - 8);
+        }
+    }
+
+    // Caves from one noise call per column, lined up along y.
+    auto column = std::array<f32, Chunk::kHeight>();
+    for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+        for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+            auto height = heights[size_t(z * ChunkSection::kSize + x)];
+            fillNoise(glm::vec3((originX + f32(x)) * kCaveFrequency, 0.0f, (originZ + f32(z)) * kCaveFrequency), glm::vec3(0.0f, kCaveFrequency, 0.0f), height, seed ^ 0xCA7Eu, column.data());
+
+            for (i32 y = 0; y < height; ++y) {
+                // The bottom layers stay solid so caves never open into the void.
+                if (y > 2 && column[size_t(y)] > kCaveThreshold) {
+                    continue;
+                }
+                chunk->setBlock(x, y, z, y + 1 == height ? 2 : 1);
+            }
+
+            auto wx = position.getBlockPositionX(x);
+            auto wz = position.getBlockPositionZ(z);
+            if (wx % 23 == 0 && wz % 19 == 0) {
+                for (i32 y = height; y < height + 8; ++y) {
+                    chunk->setBlock(x, y, z, 3);
+                }
+            }
+        }
+    }
+
+    // Generated terrain can be generated again, only edits need saving.
+    chunk->setModified(false);
+    return chunk;
+}
+
+auto TerrainGenerator::isUsingSimd() const -> bool {
+    return fillNoise != fillNoiseScalar;
+}
+
+auto TerrainGenerator::isSimdSupported() -> bool {
+#if TERRAIN_GENERATOR_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
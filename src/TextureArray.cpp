@@ -0,0 +1,127 @@
+#include "TextureArray.hpp"
+
+#include <bit>
+#include <cmath>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+// Pixels hold sRGB encoded colors, averaging them as they are darkens every
+// level. Color channels are averaged in linear space, alpha as it is.
+static auto toLinear(u32 value) -> f32 {
+    static const auto table = [] {
+        auto result = std::array<f32, 256>();
+        for (u32 i = 0; i < 256; ++i) {
+            auto c = f32(i) / 255.0f;
+            result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table[value];
+}
+
+static auto toSrgb(f32 c) -> u32 {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return u32(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+TextureArray::TextureArray(const Arc<vfx::Device>& device, Arc<vfx::Texture> fallback) : device(device), fallback(std::move(fallback)) {
+    // The shaders index the array with a different slot per lane, which is
+    // only defined with non-uniform indexing, and the whole array has to fit
+    // into the sampled images of one stage.
+    auto features = device->gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeatures>(device->interface);
+    if (!features.get<vk::PhysicalDeviceDescriptorIndexingFeatures>().shaderSampledImageArrayNonUniformIndexing) {
+        throw std::runtime_error("Device does not support non-uniform indexing of sampled image arrays");
+    }
+    auto limits = device->gpu.getProperties(device->interface).limits;
+    if (limits.maxPerStageDescriptorSampledImages < kMaxTextures || limits.maxDescriptorSetSampledImages < kMaxTextures) {
+        throw std::runtime_error("Device supports fewer sampled images per stage than the texture array holds");
+    }
+}
+
+auto TextureArray::add(Arc<vfx::Texture> texture) -> i32 {
+    if (textures.size() >= kMaxTextures) {
+        throw std::runtime_error("Too many textures");
+    }
+    textures.emplace_back(std::move(texture));
+    levelCounts.emplace_back(1);
+    return i32(textures.size()) - 1;
+}
+
+auto TextureArray::addMipmapped(u32 width, u32 height, std::span<const u32> pixels) -> i32 {
+    auto levels = i32(std::bit_width(std::max(width, height)));
+    if (textures.size() + size_t(levels) > kMaxTextures) {
+        throw std::runtime_error("Too many textures");
+    }
+
+    auto first = i32(textures.size());
+    auto level = std::vector<u32>(pixels.begin(), pixels.end());
+    for (i32 i = 0; i < levels; ++i) {
+        auto texture = device->makeTexture(vfx::TextureDescription{
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .width = width,
+            .height = height,
+            .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+        });
+        texture->update(level.data(), level.size() * sizeof(u32));
+        textures.emplace_back(std::move(texture));
+        levelCounts.emplace_back(levels - i);
+
+        auto nextWidth = std::max(width / 2, 1u);
+        auto nextHeight = std::max(height / 2, 1u);
+        auto next = std::vector<u32>(nextWidth * nextHeight);
+        for (u32 y = 0; y < nextHeight; ++y) {
+            for (u32 x = 0; x < nextWidth; ++x) {
+                u32 x0 = std::min(x * 2 + 0, width - 1);
+                u32 x1 = std::min(x * 2 + 1, width - 1);
+                u32 y0 = std::min(y * 2 + 0, height - 1);
+                u32 y1 = std::min(y * 2 + 1, height - 1);
+
+                u32 color = 0;
+                for (u32 shift = 0; shift < 24; shift += 8) {
+                    f32 sum = toLinear((level[y0 * width + x0] >> shift) & 0xFF)
+                            + toLinear((level[y0 * width + x1] >> shift) & 0xFF)
+                            + toLinear((level[y1 * width + x0] >> shift) & 0xFF)
+                            + toLinear((level[y1 * width + x1] >> shift) & 0xFF);
+                    color |= toSrgb(sum * 0.25f) << shift;
+                }
+                u32 alpha = (level[y0 * width + x0] >> 24)
+                          + (level[y0 * width + x1] >> 24)
+                          + (level[y1 * width + x0] >> 24)
+                          + (level[y1 * width + x1] >> 24);
+                color |= ((alpha + 2) / 4) << 24;
+                next[y * nextWidth + x] = color;
+            }
+        }
+
+        level = std::move(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return first;
+}
+
+auto TextureArray::getLevelCount(i32 index) const -> i32 {
+    return levelCounts[size_t(index)];
+}
+
+void TextureArray::bind(const Arc<vfx::ResourceGroup>& resourceGroup, u32 binding) const {
+    auto infos = std::vector<vk::DescriptorImageInfo>(kMaxTextures);
+    for (u32 i = 0; i < kMaxTextures; ++i) {
+        auto& texture = i < textures.size() ? textures[i] : fallback;
+        infos[i] = vk::DescriptorImageInfo{
+            .imageView = texture->view,
+            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+    }
+
+    auto write = vk::WriteDescriptorSet{
+        .dstSet = resourceGroup->set,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = kMaxTextures,
+        .descriptorType = vk::DescriptorType::eSampledImage,
+        .pImageInfo = infos.data()
+    };
+    device->handle->updateDescriptorSets(1, &write, 0, nullptr, device->interface);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <span>
+#include <vector>
+
+// Fixed-size array of sampled images behind a single binding, indexed per
+// material in the shader. Slots without a texture point at the fallback so
+// every element of the descriptor array stays valid.
+//
+// Mipmapped textures take one slot per level, the shader picks the level
+// itself and offsets the index of the first one. Throws on creation when the
+// device cannot index the array per lane or hold all of it.
+struct TextureArray {
+public:
+    // Must match kMaxTextures in raytrace.glsl.
+    static constexpr u32 kMaxTextures = 256;
+
+public:
+    TextureArray(const Arc<vfx::Device>& device, Arc<vfx::Texture> fallback);
+
+public:
+    auto add(Arc<vfx::Texture> texture) -> i32;
+
+    // Box-filters sRGB encoded RGBA8 pixels down to 1x1 in linear space and
+    // uploads every level, returns the slot of the first one.
+    auto addMipmapped(u32 width, u32 height, std::span<const u32> pixels) -> i32;
+
+    [[nodiscard]]
+    auto getLevelCount(i32 index) const -> i32;
+
+    // ResourceGroup only writes single descriptors, the array is written
+    // here in one update.
+    void bind(const Arc<vfx::ResourceGroup>& resourceGroup, u32 binding) const;
+
+private:
+    Arc<vfx::Device> device;
+    Arc<vfx::Texture> fallback;
+    std::vector<Arc<vfx::Texture>> textures = {};
+    std::vector<i32> levelCounts = {};
+};
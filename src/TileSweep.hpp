@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Core.hpp"
+#include "FrameSweep.hpp"
+
+#include <array>
+#include <vector>
+#include <algorithm>
+
+struct TileShape {
+    i32 width = 8;
+    i32 height = 8;
+    bool mortonOrder = true;
+
+    friend auto operator<=>(const TileShape&, const TileShape&) noexcept = default;
+};
+
+// Renders a fixed number of frames with every raytrace tile shape and keeps
+// the one with the lowest average GPU time. Each shape covers 64 threads,
+// a multiple of both common subgroup widths.
+struct TileSweep {
+public:
+    static constexpr auto kShapes = std::array{
+        TileShape{8, 8, true},
+        TileShape{8, 8, false},
+        TileShape{16, 4, true},
+        TileShape{16, 4, false},
+        TileShape{4, 16, true},
+        TileShape{32, 2, true},
+        TileShape{32, 2, false},
+        TileShape{64, 1, false},
+    };
+
+    struct Result {
+        TileShape shape = {};
+        f64 milliseconds = 0.0;
+    };
+
+    FrameSweep sweep = {};
+
+public:
+    void start() {
+        sweep.start(kShapes.size());
+        results.clear();
+    }
+
+    [[nodiscard]]
+    auto isRunning() const -> bool {
+        return sweep.isRunning();
+    }
+
+    // Called once per frame, returns the shape the next frame should use.
+    auto update(const GpuTimer& timer, const TileShape& current) -> TileShape {
+        if (!sweep.isRunning()) {
+            return current;
+        }
+
+        sweep.advance(timer);
+        if (!sweep.isStepDone()) {
+            return kShapes[sweep.getStep()];
+        }
+
+        results.emplace_back(Result{kShapes[sweep.getStep()], sweep.getAverageTime()});
+        if (sweep.nextStep()) {
+            return kShapes[sweep.getStep()];
+        }
+        return getBestShape();
+    }
+
+    [[nodiscard]]
+    auto getBestShape() const -> TileShape {
+        auto best = std::ranges::min_element(results, {}, &Result::milliseconds);
+        return best != results.end() ? best->shape : TileShape{};
+    }
+
+    [[nodiscard]]
+    auto getResults() const -> const std::vector<Result>& {
+        return results;
+    }
+
+private:
+    std::vector<Result> results = {};
+};
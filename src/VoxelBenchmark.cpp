@@ -0,0 +1,363 @@
+#include "VoxelBenchmark.hpp"
+#include "World.hpp"
+#include "ChunkMesher.hpp"
+#include "RegionStorage.hpp"
+#include "TerrainGenerator.hpp"
+#include "ThreadPool.hpp"
+
+#include "spdlog/spdlog.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+
+static auto getElapsedMilliseconds(std::chrono::steady_clock::time_point start) -> f64 {
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void logAccess(const char* name, u64 blocks, f64 milliseconds) {
+    spdlog::info("{}: {} blocks in {:.3f} ms ({:.2f} ns/block, {:.1f} M blocks/s)", name, blocks, milliseconds, milliseconds * 1e6 / f64(blocks), f64(blocks) / milliseconds / 1e3);
+}
+
+void runWorldAccessBenchmark() {
+    static constexpr i32 kSize = 512;
+    static constexpr i32 kHeight = 64;
+    static constexpr u64 kBlocks = u64(kSize) * kSize * kHeight;
+
+    auto world = World();
+
+    auto start = std::chrono::steady_clock::now();
+    for (i32 y = 0; y < kHeight; ++y) {
+        for (i32 z = 0; z < kSize; ++z) {
+            for (i32 x = 0; x < kSize; ++x) {
+                world.setBlock(BlockPosition{x, y, z}, BlockId(1 + ((x ^ y ^ z) & 7)));
+            }
+        }
+    }
+    logAccess("Sequential set", kBlocks, getElapsedMilliseconds(start));
+
+    u64 checksum = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (i32 y = 0; y < kHeight; ++y) {
+        for (i32 z = 0; z < kSize; ++z) {
+            for (i32 x = 0; x < kSize; ++x) {
+                checksum += world.getBlock(BlockPosition{x, y, z});
+            }
+        }
+    }
+    logAccess("Sequential get", kBlocks, getElapsedMilliseconds(start));
+
+    // xorshift keeps the generator out of the measurement as far as possible.
+    u32 state = 0x9E3779B9u;
+    auto nextPosition = [&state] {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return BlockPosition{i32(state % kSize), i32((state >> 9) % kHeight), i32((state >> 18) % kSize)};
+    };
+
+    start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < kBlocks; ++i) {
+        checksum += world.getBlock(nextPosition());
+    }
+    logAccess("Random get", kBlocks, getElapsedMilliseconds(start));
+
+    start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < kBlocks; ++i) {
+        world.setBlock(nextPosition(), BlockId(i & 7));
+    }
+    logAccess("Random set", kBlocks, getElapsedMilliseconds(start));
+
+    spdlog::info("World access benchmark: {} chunks, checksum {}", world.getChunks().size(), checksum);
+}
+
+void runSectionBenchmark() {
+    static constexpr i32 kSections = 1024;
+    static constexpr u64 kBlocks = u64(kSections) * ChunkSection::kVolume;
+
+    using FlatSection = std::array<BlockId, ChunkSection::kVolume>;
+
+    for (u32 types : {1u, 2u, 4u, 16u, 256u}) {
+        auto getBlock = [types](i32 section, i32 index) {
+            auto hash = u32(section * ChunkSection::kVolume + index) * 0x9E3779B9u;
+            return BlockId(1 + (hash >> 16) % types);
+        };
+
+        auto sections = std::vector<ChunkSection>(kSections);
+        auto flatSections = std::vector<FlatSection>(kSections);
+
+        auto start = std::chrono::steady_clock::now();
+        for (i32 s = 0; s < kSections; ++s) {
+            for (i32 y = 0; y < ChunkSection::kSize; ++y) {
+                for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                    for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                        sections[size_t(s)].setBlock(x, y, z, getBlock(s, ChunkSection::getIndex(x, y, z)));
+                    }
+                }
+            }
+        }
+        auto paletteSet = getElapsedMilliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (i32 s = 0; s < kSections; ++s) {
+            for (i32 y = 0; y < ChunkSection::kSize; ++y) {
+                for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                    for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                        auto index = ChunkSection::getIndex(x, y, z);
+                        flatSections[size_t(s)][size_t(index)] = getBlock(s, index);
+                    }
+                }
+            }
+        }
+        auto flatSet = getElapsedMilliseconds(start);
+
+        u64 checksum = 0;
+
+        start = std::chrono::steady_clock::now();
+        for (auto& section : sections) {
+            for (i32 y = 0; y < ChunkSection::kSize; ++y) {
+                for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                    for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                        checksum += section.getBlock(x, y, z);
+                    }
+                }
+            }
+        }
+        auto paletteGet = getElapsedMilliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (auto& section : flatSections) {
+            for (i32 y = 0; y < ChunkSection::kSize; ++y) {
+                for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                    for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                        checksum -= section[size_t(ChunkSection::getIndex(x, y, z))];
+                    }
+                }
+            }
+        }
+        auto flatGet = getElapsedMilliseconds(start);
+
+        size_t paletteBytes = 0;
+        for (auto& section : sections) {
+            paletteBytes += section.getMemoryUsage();
+        }
+
+        spdlog::info("{} block types, {} bits per block", types, sections.front().getBitsPerBlock());
+        spdlog::info("  memory per chunk: palette {} bytes, flat {} bytes", paletteBytes / kSections * Chunk::kSectionCount, sizeof(FlatSection) * Chunk::kSectionCount);
+        spdlog::info("  set: palette {:.2f} ns/block, flat {:.2f} ns/block", paletteSet * 1e6 / f64(kBlocks), flatSet * 1e6 / f64(kBlocks));
+        spdlog::info("  get: palette {:.2f} ns/block, flat {:.2f} ns/block", paletteGet * 1e6 / f64(kBlocks), flatGet * 1e6 / f64(kBlocks));
+        if (checksum != 0) {
+            spdlog::error("Section benchmark: palette and flat sections differ");
+        }
+    }
+}
+
+void runMeshingBenchmark(const World& world) {
+    struct MeshResult {
+        size_t triangles = 0;
+        f64 faces = 0.0;
+        f64 milliseconds = 0.0;
+    };
+
+    auto positions = std::vector<ChunkPosition>();
+    world.getChunks().forEach([&](const ChunkPosition& position, const std::unique_ptr<Chunk>&) {
+        positions.emplace_back(position);
+    });
+    if (positions.empty()) {
+        return;
+    }
+
+    auto pool = ThreadPool();
+    auto threads = std::thread::hardware_concurrency();
+
+    auto run = [&](const char* name, void(*mesh)(const World&, const ChunkPosition&, DrawList&)) {
+        auto start = std::chrono::steady_clock::now();
+
+        auto futures = std::vector<std::future<MeshResult>>();
+        futures.reserve(positions.size());
+        for (auto& position : positions) {
+            futures.emplace_back(pool.submit([&world, position, mesh] {
+                auto jobStart = std::chrono::steady_clock::now();
+                auto drawList = DrawList();
+                mesh(world, position, drawList);
+                auto result = MeshResult{
+                    .triangles = drawList.indices.size() / 3,
+                    .milliseconds = getElapsedMilliseconds(jobStart)
+                };
+                // Covered area in block faces, both meshers have to agree on it.
+                for (size_t i = 0; i < drawList.vertices.size(); i += 4) {
+                    auto& v = drawList.vertices;
+                    result.faces += f64(glm::length(glm::cross(v[i + 1].position - v[i].position, v[i + 3].position - v[i].position)));
+                }
+                return result;
+            }));
+        }
+
+        auto total = MeshResult();
+        for (auto& future : futures) {
+            auto result = future.get();
+            total.triangles += result.triangles;
+            total.faces += result.faces;
+            total.milliseconds += result.milliseconds;
+        }
+        auto wall = getElapsedMilliseconds(start);
+
+        auto chunks = f64(positions.size());
+        spdlog::info("{} meshing: {:.0f} triangles/chunk, {:.3f} ms/chunk, {} chunks in {:.1f} ms on {} threads", name, f64(total.triangles) / chunks, total.milliseconds / chunks, positions.size(), wall, threads);
+        return total;
+    };
+
+    auto naive = run("Naive", meshChunkNaive);
+    auto greedy = run("Greedy", meshChunkGreedy);
+
+    spdlog::info("Greedy meshing keeps {:.1f}% of the naive triangles", 100.0 * f64(greedy.triangles) / f64(std::max(naive.triangles, size_t(1))));
+    if (naive.faces != greedy.faces) {
+        spdlog::error("Meshing benchmark: naive and greedy meshes cover different faces");
+    }
+}
+
+void runTerrainBenchmark() {
+    static constexpr i32 kSize = 32;
+
+    auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    auto threadCounts = cores > 1 ? std::vector<u32>{1u, cores} : std::vector<u32>{1u};
+    for (auto simd : {false, true}) {
+        if (simd && !TerrainGenerator::isSimdSupported()) {
+            spdlog::info("Terrain benchmark: AVX2 is not supported");
+            continue;
+        }
+        auto generator = TerrainGenerator(42, simd);
+
+        for (auto threads : threadCounts) {
+            auto pool = ThreadPool(threads);
+            auto start = std::chrono::steady_clock::now();
+
+            auto futures = std::vector<std::future<size_t>>();
+            futures.reserve(kSize * kSize);
+            for (i32 cz = 0; cz < kSize; ++cz) {
+                for (i32 cx = 0; cx < kSize; ++cx) {
+                    futures.emplace_back(pool.submit([&generator, cx, cz] {
+                        return generator.generate(ChunkPosition{cx, cz})->getMemoryUsage();
+                    }));
+                }
+            }
+            size_t bytes = 0;
+            for (auto& future : futures) {
+                bytes += future.get();
+            }
+            auto milliseconds = getElapsedMilliseconds(start);
+
+            auto chunksPerSecond = f64(kSize * kSize) / (milliseconds / 1000.0);
+            spdlog::info("{} terrain on {} threads: {} chunks in {:.1f} ms, {:.0f} chunks/s, {:.0f} chunks/s per core, {:.1f} MB", simd ? "AVX2" : "Scalar", threads, kSize * kSize, milliseconds, chunksPerSecond, chunksPerSecond / f64(threads), f64(bytes) / 1e6);
+        }
+    }
+}
+
+// Asks the kernel to drop the cached pages of the region files. Pages that
+// are still mapped somewhere stay cached, so this is only an approximation
+// of a cold start. Elsewhere it does nothing and the cold pass reads from
+// whatever the system still caches.
+static void dropPageCache(const std::filesystem::path& directory) {
+#if defined(__linux__)
+    for (auto& entry : std::filesystem::directory_iterator(directory)) {
+        auto file = open(entry.path().c_str(), O_RDONLY);
+        if (file == -1) {
+            continue;
+        }
+        fdatasync(file);
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+#else
+    (void) directory;
+#endif
+}
+
+void runRegionBenchmark() {
+    static constexpr i32 kSize = 64;
+    static constexpr size_t kChunks = size_t(kSize) * kSize;
+
+    auto directory = std::filesystem::temp_directory_path() / "rt-region-benchmark";
+    std::filesystem::remove_all(directory);
+
+    auto pool = ThreadPool();
+    auto generator = TerrainGenerator(42);
+    auto positions = std::vector<ChunkPosition>();
+    positions.reserve(kChunks);
+    for (i32 cz = 0; cz < kSize; ++cz) {
+        for (i32 cx = 0; cx < kSize; ++cx) {
+            positions.emplace_back(ChunkPosition{cx, cz});
+        }
+    }
+
+    // Serialized copies to compare the loaded chunks against.
+    auto expected = std::vector<std::vector<u8>>(kChunks);
+    {
+        auto storage = RegionStorage(directory);
+        auto futures = std::vector<std::future<size_t>>();
+        futures.reserve(kChunks);
+        for (size_t i = 0; i < kChunks; ++i) {
+            futures.emplace_back(pool.submit([&, i] {
+                auto chunk = generator.generate(positions[i]);
+                chunk->serialize(expected[i]);
+                storage.saveChunk(*chunk);
+                return chunk->getMemoryUsage();
+            }));
+        }
+        size_t memoryUsage = 0;
+        for (auto& future : futures) {
+            memoryUsage += future.get();
+        }
+
+        size_t serializedBytes = 0;
+        for (auto& bytes : expected) {
+            serializedBytes += bytes.size();
+        }
+        size_t fileBytes = 0;
+        for (auto& entry : std::filesystem::directory_iterator(directory)) {
+            fileBytes += entry.file_size();
+        }
+        spdlog::info("Region benchmark: {} chunks, {:.1f} MB in memory, {:.1f} MB serialized, {:.1f} MB on disk", kChunks, f64(memoryUsage) / 1e6, f64(serializedBytes) / 1e6, f64(fileBytes) / 1e6);
+    }
+
+    dropPageCache(directory);
+
+    // The first pass maps every region and faults its pages in, the second
+    // reuses the mappings and the page cache.
+    auto storage = RegionStorage(directory);
+    for (auto name : {"cold", "warm"}) {
+        auto start = std::chrono::steady_clock::now();
+        auto futures = std::vector<std::future<std::unique_ptr<Chunk>>>();
+        futures.reserve(kChunks);
+        for (size_t i = 0; i < kChunks; ++i) {
+            futures.emplace_back(pool.submit([&, i] {
+                return storage.loadChunk(positions[i]);
+            }));
+        }
+        auto chunks = std::vector<std::unique_ptr<Chunk>>();
+        chunks.reserve(kChunks);
+        for (auto& future : futures) {
+            chunks.emplace_back(future.get());
+        }
+        auto milliseconds = getElapsedMilliseconds(start);
+
+        // Verified after the clock stopped, the load rate only covers loading.
+        size_t mismatches = 0;
+        for (size_t i = 0; i < kChunks; ++i) {
+            auto bytes = std::vector<u8>();
+            if (chunks[i] != nullptr) {
+                chunks[i]->serialize(bytes);
+            }
+            mismatches += chunks[i] != nullptr && bytes == expected[i] ? 0 : 1;
+        }
+        spdlog::info("Region load ({} cache): {} chunks in {:.1f} ms, {:.0f} chunks/s, {} mismatches", name, kChunks, milliseconds, f64(kChunks) / (milliseconds / 1000.0), mismatches);
+    }
+
+    std::filesystem::remove_all(directory);
+}
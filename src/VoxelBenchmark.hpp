@@ -0,0 +1,23 @@
+#pragma once
+
+// Synchronous CPU benchmarks of the voxel world, results are logged.
+
+struct World;
+
+// Sequential and random block get/set over 16M blocks.
+void runWorldAccessBenchmark();
+
+// Palette-compressed sections against a flat array of block ids, for
+// sections holding 1 to 256 distinct blocks.
+void runSectionBenchmark();
+
+// Naive and greedy meshes of every loaded chunk, one ThreadPool job per chunk.
+void runMeshingBenchmark(const World& world);
+
+// Terrain generation with the scalar and the AVX2 noise, on one thread and
+// on all of them.
+void runTerrainBenchmark();
+
+// Saves generated chunks to region files in the temp directory and loads
+// them back on the ThreadPool with a cold and a warm page cache.
+void runRegionBenchmark();
@@ -0,0 +1,44 @@
+#include "VoxelGrid.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+VoxelGrid::VoxelGrid(const World& world, const ChunkPosition& min, const ChunkPosition& max, i32 height) {
+    auto header = VoxelGridHeader{
+        .origin = glm::ivec4(min.getBlockPositionX(0), 0, min.getBlockPositionZ(0), 0),
+        .size = glm::ivec4((max.x - min.x + 1) * ChunkSection::kSize, height, (max.z - min.z + 1) * ChunkSection::kSize, 0)
+    };
+
+    auto headerWords = sizeof(VoxelGridHeader) / sizeof(u32);
+    auto blocks = size_t(header.size.x) * size_t(header.size.y) * size_t(header.size.z);
+    data.resize(headerWords + (blocks + 3) / 4);
+    std::memcpy(data.data(), &header, sizeof(VoxelGridHeader));
+
+    auto bytes = reinterpret_cast<u8*>(data.data() + headerWords);
+    for (i32 cz = min.z; cz <= max.z; ++cz) {
+        for (i32 cx = min.x; cx <= max.x; ++cx) {
+            auto chunk = world.getChunk(ChunkPosition{cx, cz});
+            if (chunk == nullptr) {
+                continue;
+            }
+            auto ox = (cx - min.x) * ChunkSection::kSize;
+            auto oz = (cz - min.z) * ChunkSection::kSize;
+            for (i32 y = 0; y < std::min(height, Chunk::kHeight); ++y) {
+                if (chunk->getSection(y >> 4) == nullptr) {
+                    y |= 15;
+                    continue;
+                }
+                for (i32 z = 0; z < ChunkSection::kSize; ++z) {
+                    for (i32 x = 0; x < ChunkSection::kSize; ++x) {
+                        auto index = (size_t(y) * size_t(header.size.z) + size_t(oz + z)) * size_t(header.size.x) + size_t(ox + x);
+                        bytes[index] = u8(std::min(chunk->getBlock(x, y, z), BlockId(255)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+auto VoxelGrid::getData() const -> const std::vector<u32>& {
+    return data;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "World.hpp"
+
+#include <vector>
+
+// Mirrors the header of voxel_grid_data in raytrace.glsl.
+struct VoxelGridHeader {
+    int4 origin;
+    int4 size;
+};
+
+// Dense copy of a box of chunks for the voxel traversal in raytrace.glsl,
+// one byte per block packed four to a word behind the header. Block ids
+// above 255 are clamped.
+struct VoxelGrid {
+public:
+    // Covers the chunks from min to max inclusive and blocks below height.
+    VoxelGrid(const World& world, const ChunkPosition& min, const ChunkPosition& max, i32 height);
+
+public:
+    [[nodiscard]]
+    auto getData() const -> const std::vector<u32>&;
+
+private:
+    std::vector<u32> data = {};
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Core.hpp"
+#include "FrameSweep.hpp"
+
+#include <array>
+#include <vector>
+#include <utility>
+
+// Renders a fixed number of frames of the brickmap at every view distance and
+// records the raytrace GPU time, the camera rays per second and how much
+// memory the brickmap takes next to a dense grid of the same area.
+struct VoxelSweep {
+public:
+    static constexpr auto kViewDistances = std::array{8, 16, 32, 64};
+
+    struct Result {
+        i32 viewDistance = 0;
+        f64 milliseconds = 0.0;
+        f64 raysPerSecond = 0.0;
+        u64 brickmapBytes = 0;
+        u64 gridBytes = 0;
+    };
+
+    FrameSweep sweep = {};
+
+public:
+    void start(i32 current) {
+        sweep.start(kViewDistances.size());
+        initialDistance = current;
+        totalRays = 0;
+        results.clear();
+    }
+
+    [[nodiscard]]
+    auto isRunning() const -> bool {
+        return sweep.isRunning();
+    }
+
+    // Memory of the structures built for the current view distance.
+    void setMemoryUsage(u64 brickmapBytes, u64 gridBytes) {
+        memoryUsage = {brickmapBytes, gridBytes};
+    }
+
+    // Called once per frame with the camera rays it traced, returns the view
+    // distance the next frame should use.
+    auto update(const GpuTimer& timer, i32 current, u64 rays) -> i32 {
+        if (!sweep.isRunning()) {
+            return current;
+        }
+
+        if (sweep.advance(timer)) {
+            totalRays += rays;
+        }
+        if (!sweep.isStepDone()) {
+            return kViewDistances[sweep.getStep()];
+        }
+
+        auto totalTime = sweep.getTotalTime();
+        results.emplace_back(Result{
+            .viewDistance = kViewDistances[sweep.getStep()],
+            .milliseconds = sweep.getAverageTime(),
+            .raysPerSecond = totalTime > 0.0 ? f64(totalRays) / (totalTime / 1000.0) : 0.0,
+            .brickmapBytes = memoryUsage.first,
+            .gridBytes = memoryUsage.second
+        });
+        totalRays = 0;
+
+        if (sweep.nextStep()) {
+            return kViewDistances[sweep.getStep()];
+        }
+        return initialDistance;
+    }
+
+    [[nodiscard]]
+    auto getResults() const -> const std::vector<Result>& {
+        return results;
+    }
+
+private:
+    i32 initialDistance = 0;
+    u64 totalRays = 0;
+    std::pair<u64, u64> memoryUsage = {};
+    std::vector<Result> results = {};
+};
@@ -0,0 +1,80 @@
+#include "World.hpp"
+
+auto World::getChunk(const ChunkPosition& position) -> Chunk* {
+    auto chunk = chunks.find(position);
+    return chunk != nullptr ? chunk->get() : nullptr;
+}
+
+auto World::getChunk(const ChunkPosition& position) const -> const Chunk* {
+    auto chunk = chunks.find(position);
+    return chunk != nullptr ? chunk->get() : nullptr;
+}
+
+auto World::createChunk(const ChunkPosition& position) -> Chunk& {
+    if (auto chunk = chunks.find(position)) {
+        return **chunk;
+    }
+    return *chunks.insert(position, std::make_unique<Chunk>(position));
+}
+
+auto World::addChunk(std::unique_ptr<Chunk> chunk) -> Chunk& {
+    auto position = chunk->getPosition();
+    dirtyChunks.insert(position, 1);
+    return *chunks.insert(position, std::move(chunk));
+}
+
+auto World::removeChunk(const ChunkPosition& position) -> bool {
+    if (!chunks.erase(position)) {
+        return false;
+    }
+    dirtyChunks.insert(position, 1);
+    return true;
+}
+
+auto World::takeChunk(const ChunkPosition& position) -> std::unique_ptr<Chunk> {
+    auto chunk = chunks.find(position);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    auto taken = std::move(*chunk);
+    chunks.erase(position);
+    dirtyChunks.insert(position, 1);
+    return taken;
+}
+
+auto World::getBlock(const BlockPosition& position) const -> BlockId {
+    if (position.y < 0 || position.y >= Chunk::kHeight) {
+        return 0;
+    }
+    auto chunk = getChunk(position.getChunkPosition());
+    if (chunk == nullptr) {
+        return 0;
+    }
+    return chunk->getBlock(position.x & 15, position.y, position.z & 15);
+}
+
+void World::setBlock(const BlockPosition& position, BlockId block) {
+    if (position.y < 0 || position.y >= Chunk::kHeight) {
+        return;
+    }
+    auto& chunk = createChunk(position.getChunkPosition());
+    if (chunk.getBlock(position.x & 15, position.y, position.z & 15) == block) {
+        return;
+    }
+    chunk.setBlock(position.x & 15, position.y, position.z & 15, block);
+    dirtyChunks.insert(chunk.getPosition(), 1);
+}
+
+auto World::takeDirtyChunks() -> std::vector<ChunkPosition> {
+    auto positions = std::vector<ChunkPosition>();
+    positions.reserve(dirtyChunks.size());
+    dirtyChunks.forEach([&](const ChunkPosition& position, u8) {
+        positions.emplace_back(position);
+    });
+    dirtyChunks.clear();
+    return positions;
+}
+
+auto World::getChunks() const -> const ChunkMap<std::unique_ptr<Chunk>>& {
+    return chunks;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Chunk.hpp"
+#include "ChunkMap.hpp"
+
+// Chunk store addressed by block and chunk positions. Blocks outside the
+// world height or in chunks that are not loaded read as air.
+struct World {
+public:
+    [[nodiscard]]
+    auto getChunk(const ChunkPosition& position) -> Chunk*;
+
+    [[nodiscard]]
+    auto getChunk(const ChunkPosition& position) const -> const Chunk*;
+
+    // Returns the existing chunk if there is one.
+    auto createChunk(const ChunkPosition& position) -> Chunk&;
+
+    // Replaces the chunk at the same position, typically one built on
+    // another thread.
+    auto addChunk(std::unique_ptr<Chunk> chunk) -> Chunk&;
+
+    auto removeChunk(const ChunkPosition& position) -> bool;
+
+    // Like removeChunk but hands the chunk to the caller, null when it is
+    // not loaded.
+    auto takeChunk(const ChunkPosition& position) -> std::unique_ptr<Chunk>;
+
+    [[nodiscard]]
+    auto getBlock(const BlockPosition& position) const -> BlockId;
+
+    // Creates the chunk when it is not loaded yet. Chunks whose blocks change
+    // are remembered until the next takeDirtyChunks.
+    void setBlock(const BlockPosition& position, BlockId block);
+
+    // Chunks edited or removed since the last call, in no particular order.
+    auto takeDirtyChunks() -> std::vector<ChunkPosition>;
+
+    [[nodiscard]]
+    auto getChunks() const -> const ChunkMap<std::unique_ptr<Chunk>>&;
+
+private:
+    ChunkMap<std::unique_ptr<Chunk>> chunks = {};
+    ChunkMap<u8> dirtyChunks = {};
+};
@@ -0,0 +1,242 @@
+#include "Chunk.hpp"
+#include "ChunkMap.hpp"
+#include "Compression.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <map>
+#include <random>
+
+static i32 failures = 0;
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        spdlog::error("Failed: {}", what);
+        failures += 1;
+    }
+}
+
+// Home slot of a position in a table of 16 entries, mirrors ChunkMap.
+static auto getHomeSlot16(const ChunkPosition& position) -> size_t {
+    auto key = (u64(u32(position.x)) << 32) | u64(u32(position.z));
+    return size_t((key * 0x9E3779B97F4A7C15ull) >> 60);
+}
+
+static void testChunkMapWraparound() {
+    // Entries homed at the last slot probe into the start of the table,
+    // followed by entries homed at the first slot.
+    auto last = std::vector<ChunkPosition>();
+    auto first = std::vector<ChunkPosition>();
+    for (i32 x = 0; last.size() < 3 || first.size() < 2; ++x) {
+        auto position = ChunkPosition{x, -x};
+        auto slot = getHomeSlot16(position);
+        if (slot == 15 && last.size() < 3) {
+            last.emplace_back(position);
+        } else if (slot == 0 && first.size() < 2) {
+            first.emplace_back(position);
+        }
+    }
+
+    auto map = ChunkMap<i32>();
+    auto positions = std::vector<ChunkPosition>();
+    positions.insert(positions.end(), last.begin(), last.end());
+    positions.insert(positions.end(), first.begin(), first.end());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        map.insert(positions[i], i32(i));
+    }
+
+    for (size_t erased = 0; erased < positions.size(); ++erased) {
+        expect(map.erase(positions[erased]), "erase of a present position");
+        expect(!map.erase(positions[erased]), "erase of an erased position");
+        expect(map.size() == positions.size() - erased - 1, "size after erase");
+        for (size_t i = erased + 1; i < positions.size(); ++i) {
+            auto value = map.find(positions[i]);
+            expect(value != nullptr && *value == i32(i), "find after erase across the wraparound");
+        }
+    }
+}
+
+static void testChunkMapRandom() {
+    auto random = std::mt19937(7);
+    auto map = ChunkMap<i32>();
+    auto reference = std::map<std::pair<i32, i32>, i32>();
+    for (i32 i = 0; i < 20000; ++i) {
+        auto position = ChunkPosition{i32(random() % 12) - 6, i32(random() % 12) - 6};
+        auto key = std::pair{position.x, position.z};
+        if (random() % 2 == 0) {
+            map.insert(position, i);
+            reference[key] = i;
+        } else {
+            expect(map.erase(position) == (reference.erase(key) != 0), "erase matches the reference");
+        }
+    }
+
+    expect(map.size() == reference.size(), "size matches the reference");
+    for (auto& [key, value] : reference) {
+        auto found = map.find(ChunkPosition{key.first, key.second});
+        expect(found != nullptr && *found == value, "find matches the reference");
+    }
+}
+
+static auto matches(const ChunkSection& section, const std::vector<BlockId>& reference) -> bool {
+    for (i32 i = 0; i < ChunkSection::kVolume; ++i) {
+        if (section.getBlock(i & 15, i >> 8, (i >> 4) & 15) != reference[size_t(i)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testSectionWidths() {
+    auto section = ChunkSection();
+    auto reference = std::vector<BlockId>(ChunkSection::kVolume, 0);
+    auto set = [&](i32 i, BlockId block) {
+        section.setBlock(i & 15, i >> 8, (i >> 4) & 15, block);
+        reference[size_t(i)] = block;
+    };
+
+    // Every new block type may widen the indices, up to 16 bits.
+    for (i32 types = 1; types <= 300; ++types) {
+        auto bits = section.getBitsPerBlock();
+        set(types * 13, BlockId(types));
+        auto expected = types + 1 <= 2 ? 1u : types + 1 <= 4 ? 2u : types + 1 <= 16 ? 4u : types + 1 <= 256 ? 8u : 16u;
+        expect(section.getBitsPerBlock() == expected, "width after adding a block type");
+        if (section.getBitsPerBlock() != bits) {
+            expect(matches(section, reference), "blocks after widening");
+        }
+    }
+
+    // Overwriting everything with three types shrinks back once enough
+    // writes happened since the last repack.
+    for (i32 i = 0; i < ChunkSection::kVolume; ++i) {
+        set(i, BlockId(1 + i % 3));
+    }
+    expect(section.getBitsPerBlock() == 2, "width after overwriting with three block types");
+    expect(matches(section, reference), "blocks after shrinking");
+
+    // Types added and removed right away keep the wider indices.
+    set(0, 7);
+    set(1, 8);
+    expect(section.getBitsPerBlock() == 4, "width after adding two block types");
+    set(0, 1);
+    set(1, 2);
+    expect(section.getBitsPerBlock() == 4, "width after removing the two block types");
+    expect(matches(section, reference), "blocks after removing the two block types");
+
+    for (i32 i = 0; i < ChunkSection::kVolume; ++i) {
+        set(i, 0);
+    }
+    expect(section.isEmpty() && section.getBitsPerBlock() == 0, "empty after clearing");
+}
+
+static void testCompression() {
+    auto random = std::mt19937(11);
+    auto inputs = std::vector<std::vector<u8>>();
+    for (auto size : {0, 1, 7, 300, 4096, 70000}) {
+        auto noise = std::vector<u8>(size_t(size));
+        for (auto& byte : noise) {
+            byte = u8(random());
+        }
+        auto runs = std::vector<u8>(size_t(size));
+        for (size_t i = 0; i < runs.size(); ++i) {
+            runs[i] = u8((i / 37) % 5);
+        }
+        inputs.emplace_back(std::move(noise));
+        inputs.emplace_back(std::move(runs));
+    }
+
+    for (auto& input : inputs) {
+        auto payload = compress(input);
+        auto output = std::vector<u8>(input.size());
+        expect(decompress(payload, output) && output == input, "round trip");
+
+        auto larger = std::vector<u8>(input.size() + 1);
+        expect(!decompress(payload, larger), "decompress into a larger output");
+        if (!input.empty()) {
+            auto smaller = std::vector<u8>(input.size() - 1);
+            expect(!decompress(payload, smaller), "decompress into a smaller output");
+        }
+
+        // Every truncation is detected, checked at up to 64 cut points.
+        auto step = std::max(payload.size() / 64, size_t(1));
+        for (size_t size = 0; size < payload.size(); size += step) {
+            expect(!decompress(std::span(payload.data(), size), output), "decompress of a truncated payload");
+        }
+    }
+
+    // Garbage only has to be rejected or decoded without touching memory
+    // outside the buffers, the sanitizers of the Tests target catch the
+    // latter.
+    auto output = std::vector<u8>(4096);
+    for (i32 i = 0; i < 2000; ++i) {
+        auto garbage = std::vector<u8>(random() % 512);
+        for (auto& byte : garbage) {
+            byte = u8(random());
+        }
+        (void) decompress(garbage, output);
+    }
+}
+
+static void testDamagedChunk() {
+    auto position = ChunkPosition{3, -5};
+    auto chunk = Chunk(position);
+    for (i32 i = 0; i < ChunkSection::kVolume; ++i) {
+        chunk.setBlock(i & 15, i >> 8, (i >> 4) & 15, BlockId(1 + i % 5));
+        chunk.setBlock(i & 15, 40 + (i >> 8), (i >> 4) & 15, BlockId(i % 2));
+    }
+    auto data = std::vector<u8>();
+    chunk.serialize(data);
+
+    auto copy = Chunk::deserialize(position, data);
+    expect(copy != nullptr, "deserialize of an intact payload");
+    if (copy != nullptr) {
+        auto same = true;
+        for (i32 y = 0; y < Chunk::kHeight; ++y) {
+            for (i32 i = 0; i < ChunkSection::kSize * ChunkSection::kSize; ++i) {
+                same &= copy->getBlock(i & 15, y, i >> 4) == chunk.getBlock(i & 15, y, i >> 4);
+            }
+        }
+        expect(same, "blocks after deserialize");
+    }
+
+    for (size_t size = 0; size < data.size(); size += 97) {
+        expect(Chunk::deserialize(position, std::span(data.data(), size)) == nullptr, "deserialize of a truncated payload");
+    }
+
+    // The first section starts after the 16-bit mask with its index width,
+    // the palette size, six palette entries with the unused air and then
+    // the 4-bit indices.
+    auto damage = [&](size_t offset, u8 value) {
+        auto damaged = data;
+        damaged[offset] = value;
+        return Chunk::deserialize(position, damaged);
+    };
+    expect(damage(2, 3) == nullptr, "deserialize with an index width that is not a power of two");
+    expect(damage(2, 32) == nullptr, "deserialize with an index width above 16 bits");
+    expect(damage(3, 0) == nullptr, "deserialize with an empty palette");
+    expect(damage(3, 17) == nullptr, "deserialize with a palette larger than its width");
+    expect(damage(17, 0xFF) == nullptr, "deserialize with an index outside the palette");
+
+    // Like the garbage above, random damage is left to the sanitizers.
+    auto random = std::mt19937(13);
+    for (i32 i = 0; i < 2000; ++i) {
+        auto damaged = data;
+        damaged[random() % damaged.size()] = u8(random());
+        (void) Chunk::deserialize(position, damaged);
+    }
+}
+
+auto main() -> int {
+    testChunkMapWraparound();
+    testChunkMapRandom();
+    testSectionWidths();
+    testCompression();
+    testDamagedChunk();
+
+    if (failures != 0) {
+        spdlog::error("{} checks failed", failures);
+        return 1;
+    }
+    spdlog::info("All checks passed");
+    return 0;
+}